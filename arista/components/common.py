@@ -1,10 +1,10 @@
 
 import logging
 import os
-import time
 
 from ..core.component import Component, DEFAULT_WAIT_TIMEOUT
 from ..core.driver import KernelDriver
+from ..core.uevent import waitForPath
 from ..core.utils import inSimulation
 from ..core.types import PciAddr, I2cAddr
 
@@ -18,10 +18,14 @@ class I2cComponent(Component):
       assert isinstance(addr, I2cAddr)
       super(I2cComponent, self).__init__(addr=addr, **kwargs)
 
+# i2c drivers that register neither i2c adapters nor hwmon devices
+CONCURRENT_I2C_DRIVERS = ['sff8436']
+
 class I2cKernelComponent(I2cComponent):
    def __init__(self, addr, name, waitFile=None, **kwargs):
       super(I2cKernelComponent, self).__init__(addr, **kwargs)
       self.addDriver(I2cKernelDriver, name, waitFile)
+      self.concurrentSetup = name in CONCURRENT_I2C_DRIVERS
 
 class PciKernelDriver(KernelDriver):
    def __init__(self, component, name, args=None):
@@ -43,6 +47,10 @@ class I2cKernelDriver(KernelDriver):
    def getSysfsBusPath(self):
       return '/sys/bus/i2c/devices/i2c-%d' % self.component.addr.bus
 
+   def getKernelModules(self):
+      # loading the client driver ahead lets new_device bind it immediately
+      return ['i2c:%s' % self.name]
+
    def setup(self):
       addr = self.component.addr
       devicePath = self.getSysfsPath()
@@ -74,18 +82,15 @@ class I2cKernelDriver(KernelDriver):
 
 class SwitchChip(PciComponent):
    def waitForIt(self, timeout=DEFAULT_WAIT_TIMEOUT):
-      end = time.time() + timeout
       devPath = os.path.join('/sys/bus/pci/devices/', str(self.addr))
 
       logging.debug('waiting for switch chip %s', devPath)
       if inSimulation():
          return True
 
-      while time.time() < end:
-         if os.path.exists(devPath):
-            logging.debug('switch chip is ready')
-            return True
-         time.sleep(0.1)
+      if waitForPath(devPath, timeout):
+         logging.debug('switch chip is ready')
+         return True
 
       logging.error('timed out waiting for the switch chip %s', devPath)
       return False
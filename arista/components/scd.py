@@ -2,6 +2,8 @@ from __future__ import print_function, with_statement
 
 import os
 import logging
+import struct
+import time
 
 from collections import OrderedDict, namedtuple
 
@@ -10,8 +12,32 @@ from ..core.types import Gpio, ResetGpio, NamedGpio
 from ..core.utils import sysfsFmtHex, sysfsFmtDec, sysfsFmtStr, simulateWith, \
                          inSimulation
 
+from ..core.libscd import LibScd
+from ..core.profiler import profiler
+
 from common import PciComponent, KernelDriver, PciKernelDriver
 
+SFP_GPIO_NAMES = [
+   "rxlos", "txfault", "present", "rxlos_changed", "txfault_changed",
+   "present_changed", "txdisable", "rate_select0", "rate_select1",
+]
+
+QSFP_GPIO_NAMES = [
+   "interrupt", "present", "interrupt_changed", "present_changed",
+   "lp_mode", "reset", "modsel",
+]
+
+def profileInitTrigger(path, component):
+   if not profiler.enabled or inSimulation():
+      return
+   try:
+      with open(os.path.join(path, 'init_duration_ns')) as f:
+         duration = int(f.read())
+   except (IOError, ValueError):
+      # driver that predates init_duration_ns
+      return
+   profiler.addKernelEvent('init_trigger', duration, component=str(component))
+
 class ScdSysfsGroup(object):
    def __init__(self, objNum, typeStr, driver):
       self.driver = driver
@@ -44,6 +70,37 @@ class ScdSysfsRW(ScdSysfsGroup):
          f.write(str(value))
       return True
 
+class ScdMmapRW(ScdSysfsRW):
+   """Same interface as ScdSysfsRW but reads and writes the scd registers
+   directly through the mapped resource0 using the layout of the Scd component.
+   Falls back to sysfs for entries it doesn't know about."""
+   def __init__(self, objNum, typeStr, driver):
+      ScdSysfsRW.__init__(self, objNum, typeStr, driver)
+      self.scd = driver.component
+
+   @simulateWith(ScdSysfsRW.readValueSim)
+   def readValue(self, name):
+      lib = self.scd.getLibScd()
+      entry = self.scd.getGpioLayout().get(self.prefix + name)
+      if lib is None or entry is None:
+         return ScdSysfsRW.readValue(self, name)
+      if entry.reset:
+         return str(lib.resetGet(entry.addr, entry.bit))
+      return str(lib.gpioGet(entry.addr, entry.bit, entry.activeLow))
+
+   @simulateWith(ScdSysfsRW.writeValueSim)
+   def writeValue(self, name, value):
+      lib = self.scd.getLibScd()
+      entry = self.scd.getGpioLayout().get(self.prefix + name)
+      if lib is None or entry is None:
+         return ScdSysfsRW.writeValue(self, name, value)
+      if entry.ro:
+         return False
+      if entry.reset:
+         lib.resetSet(entry.addr, entry.bit, int(value))
+         return True
+      return lib.gpioSet(entry.addr, entry.bit, int(value), entry.activeLow)
+
 class ScdSysfsOldRW(ScdSysfsRW):
    def __init__(self, objNum, typeStr, driver):
       ScdSysfsRW.__init__(self, objNum, typeStr, driver)
@@ -105,6 +162,39 @@ class ScdKernelPsu(Psu):
       else:
          return self.getPresence()
 
+class ScdHwmonConfig(object):
+   """Binary configuration understood by the new_object_bin attribute of
+   scd-hwmon, see struct scd_config_header in src/scd-hwmon.h"""
+   MAGIC = 0x43444353
+   VERSION = 1
+
+   MASTER = 1
+   LED = 2
+   QSFP = 3
+   SFP = 4
+   RESET = 5
+   GPIO = 6
+
+   GPIO_RO = 1 << 0
+   GPIO_ACTIVE_LOW = 1 << 1
+
+   headerFmt = '<IHHI'
+   recordFmt = '<BBHIII'
+
+   def __init__(self):
+      self.records = []
+
+   def add(self, objType, addr, arg0=0, arg1=0, flags=0, name=''):
+      name = name.encode()
+      self.records.append(struct.pack(self.recordFmt, objType, len(name), flags,
+                                      addr, arg0, arg1) + name)
+
+   def pack(self):
+      body = b''.join(self.records)
+      size = struct.calcsize(self.headerFmt) + len(body)
+      return struct.pack(self.headerFmt, self.MAGIC, self.VERSION,
+                         len(self.records), size) + body
+
 class ScdHwmonKernelDriver(PciKernelDriver):
    def __init__(self, scd):
       super(ScdHwmonKernelDriver, self).__init__(scd, 'scd-hwmon')
@@ -141,9 +231,83 @@ class ScdHwmonKernelDriver(PciKernelDriver):
       if data:
          self.writeConfig(self.getSysfsPath(), {filename: '\n'.join(data)})
 
+   def binaryConfig(self):
+      scd = self.component
+      config = ScdHwmonConfig()
+
+      for addr, info in scd.masters.items():
+         config.add(ScdHwmonConfig.MASTER, addr, info['id'], info['bus'])
+
+      for addr, name in scd.leds:
+         config.add(ScdHwmonConfig.LED, addr, name=name)
+
+      for addr, info in scd.qsfps.items():
+         config.add(ScdHwmonConfig.QSFP, addr, info['id'])
+
+      for addr, info in scd.sfps.items():
+         config.add(ScdHwmonConfig.SFP, addr, info['id'])
+
+      for reset in scd.resets:
+         config.add(ScdHwmonConfig.RESET, reset.addr, reset.bit, name=reset.name)
+
+      for gpio in scd.gpios:
+         flags = ScdHwmonConfig.GPIO_RO if gpio.ro else 0
+         flags |= ScdHwmonConfig.GPIO_ACTIVE_LOW if gpio.activeLow else 0
+         config.add(ScdHwmonConfig.GPIO, gpio.addr, gpio.bit, flags=flags,
+                    name=gpio.name)
+
+      return config.pack()
+
+   def writeBinaryConfigSim(self, data):
+      logging.info('writting %d bytes of binary configuration', len(data))
+      return True
+
+   @simulateWith(writeBinaryConfigSim)
+   def writeBinaryConfig(self, data):
+      path = os.path.join(self.getSysfsPath(), 'new_object_bin')
+      if not os.path.exists(path):
+         # older driver, only the text configuration is supported
+         return False
+      # the header goes alone first, the driver only checks it on that write
+      headerSize = struct.calcsize(ScdHwmonConfig.headerFmt)
+      fd = os.open(path, os.O_WRONLY)
+      try:
+         try:
+            os.write(fd, data[:headerSize])
+         except OSError as e:
+            logging.error('%s %s, falling back to new_object', path, e.strerror)
+            return False
+         # past the header the driver removes what it created on error, the
+         # same configuration would fail again through new_object
+         offset = headerSize
+         while offset < len(data):
+            offset += os.write(fd, data[offset:])
+      except OSError as e:
+         logging.error('%s %s', path, e.strerror)
+         raise
+      finally:
+         os.close(fd)
+      return True
+
    def setup(self):
       super(ScdHwmonKernelDriver, self).setup()
 
+      scd = self.component
+
+      logging.debug('creating scd objects')
+      if not self.writeBinaryConfig(self.binaryConfig()):
+         self.writeComponents(self.textConfig(), "new_object")
+
+      tweaks = []
+      for tweak in scd.tweaks:
+         tweaks += ["%#x %#x %#x %#x %#x" % (
+            tweak.bus, tweak.addr, tweak.t, tweak.datr, tweak.datw)]
+
+      if tweaks:
+         logging.debug('applying scd tweaks')
+         self.writeComponents(tweaks, "smbus_tweaks")
+
+   def textConfig(self):
       scd = self.component
       data = []
 
@@ -166,22 +330,34 @@ class ScdHwmonKernelDriver(PciKernelDriver):
          data += ["gpio %#x %s %u %d %d" % (gpio.addr, gpio.name, gpio.bit,
                                             int(gpio.ro), int(gpio.activeLow))]
 
-      tweaks = []
-      for tweak in scd.tweaks:
-         tweaks += ["%#x %#x %#x %#x %#x" % (
-            tweak.bus, tweak.addr, tweak.t, tweak.datr, tweak.datw)]
+      return data
 
-      logging.debug('creating scd objects')
-      self.writeComponents(data, "new_object")
+   def waitSmbusReadySim(self, timeout=None):
+      return True
 
-      if tweaks:
-         logging.debug('applying scd tweaks')
-         self.writeComponents(tweaks, "smbus_tweaks")
+   @simulateWith(waitSmbusReadySim)
+   def waitSmbusReady(self, timeout=2):
+      path = os.path.join(self.getSysfsPath(), 'smbus_ready')
+      if not os.path.exists(path):
+         return True
+
+      logging.debug('waiting for the smbus masters to be ready')
+      end = time.time() + timeout
+      while time.time() < end:
+         with open(path) as f:
+            if f.read().strip() == '1':
+               return True
+         time.sleep(0.01)
+
+      logging.error('timed out waiting for the smbus masters of %s', path)
+      return False
 
    def finish(self):
       logging.debug('applying scd configuration')
       path = self.getSysfsPath()
       self.writeConfig(path, {'init_trigger': '1'})
+      profileInitTrigger(path, self.component)
+      self.waitSmbusReady()
       super(ScdHwmonKernelDriver, self).finish()
 
    def resetSim(self, value):
@@ -321,6 +497,7 @@ class ScdKernelDriver(PciKernelDriver):
       logging.debug('applying scd configuration')
       path = self.getSysfsPath()
       self.writeConfig(path, {'init_trigger': '1'})
+      profileInitTrigger(path, self.component)
 
       # FIXME: the direction should be set properly by the driver
       logging.debug('setting gpio directions')
@@ -352,12 +529,13 @@ class ScdKernelDriver(PciKernelDriver):
 
 class Scd(PciComponent):
    BusTweak = namedtuple('BusTweak', 'bus, addr, t, datr, datw')
-   def __init__(self, addr, newDriver=False):
+   GpioLayout = namedtuple('GpioLayout', 'addr, bit, ro, activeLow, reset')
+   def __init__(self, addr, newDriver=False, mmapRW=False):
       super(Scd, self).__init__(addr)
       self.addDriver(KernelDriver, 'scd')
       if newDriver:
          self.addDriver(ScdHwmonKernelDriver)
-         self.rwCls = ScdSysfsRW
+         self.rwCls = ScdMmapRW if mmapRW else ScdSysfsRW
       else:
          self.addDriver(ScdKernelDriver)
          self.rwCls = ScdSysfsOldRW
@@ -368,6 +546,8 @@ class Scd(PciComponent):
       self.sfps = OrderedDict()
       self.leds = []
       self.tweaks = []
+      self.gpioLayout = None
+      self.libScd = None
 
    def addBusTweak(self, bus, addr, t=1, datr=1, datw=3):
       self.tweaks.append(Scd.BusTweak(bus, addr, t, datr, datw))
@@ -448,23 +628,44 @@ class Scd(PciComponent):
                res += [ ("%s%d_%s" % (xcvrType, data['id'], name), gpio.ro) ]
          return res
 
-      sfp_names = [
-         "rxlos", "txfault", "present", "rxlos_changed", "txfault_changed",
-         "present_changed", "txdisable", "rate_select0", "rate_select1",
-      ]
-
-      qsfp_names = [
-         "interrupt", "present", "interrupt_changed", "present_changed",
-         "lp_mode", "reset", "modsel",
-      ]
-
       gpios = []
-      gpios += zipXcvr("sfp", sfp_names, self.sfps)
-      gpios += zipXcvr("qsfp", qsfp_names, self.qsfps)
+      gpios += zipXcvr("sfp", SFP_GPIO_NAMES, self.sfps)
+      gpios += zipXcvr("qsfp", QSFP_GPIO_NAMES, self.qsfps)
       gpios += [ (gpio.name, gpio.ro) for gpio in self.gpios ]
       gpios += [ (reset.name, False) for reset in self.resets ]
       return gpios
 
+   def getGpioLayout(self):
+      if self.gpioLayout is not None:
+         return self.gpioLayout
+
+      layout = {}
+      for xcvrType, names, entries in [("sfp", SFP_GPIO_NAMES, self.sfps),
+                                       ("qsfp", QSFP_GPIO_NAMES, self.qsfps)]:
+         for addr, data in entries.items():
+            for name, gpio in zip(names, data['gpios']):
+               key = "%s%d_%s" % (xcvrType, data['id'], name)
+               layout[key] = Scd.GpioLayout(addr, gpio.bit, gpio.ro,
+                                            gpio.activeLow, False)
+      for gpio in self.gpios:
+         layout[gpio.name] = Scd.GpioLayout(gpio.addr, gpio.bit, gpio.ro,
+                                            gpio.activeLow, False)
+      for reset in self.resets:
+         layout[reset.name] = Scd.GpioLayout(reset.addr, reset.bit, False,
+                                             reset.activeLow, True)
+
+      self.gpioLayout = layout
+      return layout
+
+   def getLibScd(self):
+      if self.libScd is None:
+         try:
+            self.libScd = LibScd(self.drivers[1].getSysfsPath())
+         except OSError as e:
+            logging.debug('scd registers not mapped, using sysfs: %s', e)
+            self.libScd = False
+      return self.libScd or None
+
    def getSysfsResetNameList(self, xcvrs=True):
       entries = [reset.name for reset in self.resets]
       if xcvrs:
@@ -0,0 +1,78 @@
+import logging
+import os
+
+from ..core.driver import KernelDriver
+from ..core.utils import inSimulation
+
+THERMAL_CLASS_PATH = '/sys/class/thermal'
+THERMAL_DEVICE_PATH = '/sys/devices/platform/arista-thermal'
+
+def i2cSensor(addr, reg):
+   """Sensor read by arista-thermal through the i2c device created at addr,
+   reg holds the temperature in degrees as a signed byte"""
+   return '%s:%02x' % (addr, reg)
+
+class ThermalDriver(KernelDriver):
+   """Loads arista-thermal and writes the fan control policy of the platform.
+
+   sensors are thermal zone types or i2cSensor() and table (temp, pwm) points
+   in millidegrees. Only the zones registered on this system are used. The i2c
+   devices are created by the components after the drivers are set up, so the
+   i2c sensors are always kept and skipped by the loop while they can't be
+   read. When there is no sensor left the loop stays off and the fans are left
+   to userspace.
+   """
+   def __init__(self, component, sensors, table, minPwm=0):
+      super(ThermalDriver, self).__init__(component, 'arista-thermal',
+                                          waitFile=THERMAL_DEVICE_PATH)
+      self.sensors = sensors
+      self.table = table
+      self.minPwm = minPwm
+
+   def getZones(self):
+      zones = set()
+      if not os.path.isdir(THERMAL_CLASS_PATH):
+         return zones
+      for name in os.listdir(THERMAL_CLASS_PATH):
+         if not name.startswith('thermal_zone'):
+            continue
+         with open(os.path.join(THERMAL_CLASS_PATH, name, 'type')) as f:
+            zones.add(f.read().strip())
+      return zones
+
+   def getSensors(self):
+      zones = self.getZones()
+      return [sensor for sensor in self.sensors
+              if ':' in sensor or sensor in zones]
+
+   def writeAttr(self, name, value):
+      path = os.path.join(THERMAL_DEVICE_PATH, name)
+      if inSimulation():
+         logging.debug('writing %s to %s', value, path)
+         return
+      with open(path, 'w') as f:
+         f.write(value)
+
+   def setup(self):
+      super(ThermalDriver, self).setup()
+
+      sensors = self.sensors if inSimulation() else self.getSensors()
+      if not sensors:
+         logging.warning('none of the sensors %s is available, '
+                         'leaving the fan control loop off',
+                         ', '.join(self.sensors))
+         return
+
+      # the mode goes last, the loop must not run with a partial policy
+      self.writeAttr('sensors', ' '.join(sensors))
+      self.writeAttr('min_pwm', str(self.minPwm))
+      self.writeAttr('table', ' '.join('%d:%d' % point for point in self.table))
+      self.writeAttr('mode', 'table')
+
+   def clean(self):
+      if self.loaded():
+         try:
+            self.writeAttr('mode', 'off')
+         except IOError as e:
+            logging.debug('failed to stop the fan control loop: %s', e)
+      super(ThermalDriver, self).clean()
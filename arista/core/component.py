@@ -2,6 +2,8 @@ from __future__ import print_function
 from collections import defaultdict
 
 from driver import Driver
+from profiler import profile
+from scheduler import Scheduler, DEFAULT_SETUP_WORKERS
 from utils import flatten
 
 DEFAULT_WAIT_TIMEOUT = 5
@@ -11,6 +13,10 @@ class Priority:
    BACKGROUND = 1
 
 class Component(object):
+   # whether setup can run concurrently with the other components, only for the
+   # ones that register neither i2c adapters nor hwmon devices
+   concurrentSetup = False
+
    def __init__(self, priority=Priority.DEFAULT, **kwargs):
       self.components = defaultdict(list)
       self.drivers = []
@@ -43,17 +49,52 @@ class Component(object):
 
    def setup(self):
       for driver in self.drivers:
-         driver.setup()
+         with profile('setup', driver, component=str(self)):
+            driver.setup()
       for driver in self.drivers:
-         driver.finish()
+         with profile('finish', driver, component=str(self)):
+            driver.finish()
 
-   def finish(self, priority=Priority.DEFAULT):
+   def finish(self, priority=Priority.DEFAULT, workers=DEFAULT_SETUP_WORKERS):
       # underlying component are initialized recursively but require the parent to
-      # be fully initialized
+      # be fully initialized.
+      # The i2c adapters and hwmon devices are numbered in the order they are
+      # registered and the platforms rely on these numbers. Components that may
+      # register some are set up one after the other in the order of a sequential
+      # setup, the others only wait for their parent and run concurrently.
+      scheduler = Scheduler(workers)
+      tasks = {}
+      previous = None
+      for component, parent in self._setupOrder(priority):
+         after = [tasks[parent]] if parent in tasks else []
+         if not component.concurrentSetup:
+            if previous is not None:
+               after.append(previous)
+         task = scheduler.add(component.setup, after=after)
+         if not component.concurrentSetup:
+            previous = task
+         tasks[component] = task
+      scheduler.run()
+
+   def _setupOrder(self, priority):
+      # order of the setups of a sequential finish, with the parent of each
+      # component when it is set up by the same pass
+      order = []
+      parent = self if priority == Priority.DEFAULT else None
       for component in self.components[priority]:
-         component.setup()
+         order.append((component, parent))
       for component in self.components[Priority.DEFAULT]:
-         component.finish(priority)
+         order += component._setupOrder(priority)
+      return order
+
+   def getKernelModules(self, priority=Priority.DEFAULT):
+      modules = []
+      if self.priority == priority:
+         for driver in self.drivers:
+            modules += driver.getKernelModules()
+      for component in flatten(self.components.values()):
+         modules += component.getKernelModules(priority)
+      return modules
 
    def clean(self):
       for component in flatten(self.components.values()):
@@ -75,7 +116,8 @@ class Component(object):
 
    def waitForIt(self, timeout=DEFAULT_WAIT_TIMEOUT):
       for component in flatten(self.components.values()):
-         component.waitForIt(timeout)
+         with profile('waitForIt', component):
+            component.waitForIt(timeout)
 
    def _dumpDrivers(self, depth, prefix):
       if len(self.drivers) == 1:
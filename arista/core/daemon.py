@@ -0,0 +1,483 @@
+"""
+Long lived platform daemon and its client
+
+Building the platform object means importing every platform, reading the
+prefdl and instantiating the whole component tree. The sonic plugins used to
+pay that price on every load. Instead, 'arista daemon' builds the platform once
+and answers hardware queries on a unix socket, the plugins only keep a
+connection to it and fall back to building the platform themselves when the
+daemon is not running. A client whose connection breaks, for instance because
+the daemon was restarted, reconnects on its next request.
+
+Each client is served by its own thread so that a slow hardware read only
+delays the client that asked for it.
+
+Every message, request or response, starts with the same header
+   u8 op, u8 status, u32 payload length
+followed by a payload made of fixed size little endian records that depend on
+the op. An empty port list in a request means every port. The only exception is
+OP_INVENTORY which returns the static description of the platform as json, it is
+only requested once per client.
+"""
+
+import errno
+import json
+import logging
+import os
+import select
+import socket
+import struct
+import threading
+import time
+
+from uevent import addUeventListener
+
+SOCKET_PATH = '/var/run/arista.sock'
+DEFAULT_CACHE_TTL = 0.5
+CLIENT_TIMEOUT = 1
+REQUEST_TIMEOUT = 5
+REQUEST_RETRIES = 3
+RECONNECT_DELAY = 0.5
+
+OP_INVENTORY = 1
+OP_XCVR_PRESENCE = 2
+OP_XCVR_LPMODE = 3
+OP_XCVR_SET_LPMODE = 4
+OP_XCVR_RESET = 5
+OP_PSU_STATUS = 6
+OP_LED_SET = 7
+
+STATUS_OK = 0
+STATUS_ERROR = 1
+
+HEADER = struct.Struct('<BBI')
+PORT = struct.Struct('<H')
+PORT_VALUE = struct.Struct('<HB')
+PSU_STATUS = struct.Struct('<BBB')
+LED_VALUE = struct.Struct('<B')
+
+MAX_PAYLOAD = 1 << 16
+
+def packRecords(fmt, records):
+   return b''.join(fmt.pack(*record) for record in records)
+
+def unpackRecords(fmt, payload):
+   if len(payload) % fmt.size:
+      raise ValueError('truncated payload')
+   return [fmt.unpack_from(payload, offset)
+           for offset in range(0, len(payload), fmt.size)]
+
+def packLeds(leds):
+   data = []
+   for name, value in leds.items():
+      name = name.encode()
+      data.append(struct.pack('<B', len(name)) + name + LED_VALUE.pack(value))
+   return b''.join(data)
+
+def unpackLeds(payload):
+   leds = {}
+   offset = 0
+   while offset < len(payload):
+      length, = struct.unpack_from('<B', payload, offset)
+      offset += 1
+      name = payload[offset:offset + length].decode()
+      offset += length
+      value, = LED_VALUE.unpack_from(payload, offset)
+      offset += LED_VALUE.size
+      leds[name] = value
+   return leds
+
+def recvAll(sock, size):
+   data = b''
+   while len(data) < size:
+      chunk = sock.recv(size - len(data))
+      if not chunk:
+         raise EOFError('connection closed')
+      data += chunk
+   return data
+
+def recvMessage(sock):
+   op, status, length = HEADER.unpack(recvAll(sock, HEADER.size))
+   if length > MAX_PAYLOAD:
+      raise ValueError('payload too large (%d bytes)' % length)
+   return op, status, recvAll(sock, length)
+
+def sendMessage(sock, op, status, payload=b''):
+   sock.sendall(HEADER.pack(op, status, len(payload)) + payload)
+
+# kinds of cache entries dropped on the uevents of each subsystem
+UEVENT_INVALIDATIONS = {
+   'i2c': ['present', 'lp_mode'],
+   'power_supply': ['psu_present', 'psu_status'],
+   'hwmon': ['psu_present', 'psu_status'],
+}
+
+class StateCache(object):
+   """Hardware values read by the daemon, kept for a short while.
+
+   Entries are keyed by (kind, index). They are dropped as soon as the daemon
+   itself changes the hardware state they depend on or the kernel reports a
+   change through a uevent, see UEVENT_INVALIDATIONS. The scd gpios (xcvr and
+   psu presence) generate no event, entries expire after ttl seconds to bound
+   how long such a change goes unnoticed.
+   """
+   def __init__(self, ttl=DEFAULT_CACHE_TTL):
+      self.ttl = ttl
+      self.lock = threading.Lock()
+      self.entries = {}
+      self.generation = 0
+
+   def get(self, key, read):
+      now = time.time()
+      with self.lock:
+         entry = self.entries.get(key)
+         if entry is not None and now - entry[1] < self.ttl:
+            return entry[0]
+         generation = self.generation
+      value = read()
+      with self.lock:
+         # the value may predate an invalidation that happened while reading
+         if generation == self.generation:
+            self.entries[key] = (value, now)
+      return value
+
+   def invalidate(self, *keys):
+      with self.lock:
+         self.generation += 1
+         for key in keys:
+            self.entries.pop(key, None)
+
+   def invalidateKinds(self, kinds):
+      with self.lock:
+         self.generation += 1
+         for key in [key for key in self.entries if key[0] in kinds]:
+            del self.entries[key]
+
+class PlatformDaemon(object):
+   def __init__(self, platform, path=SOCKET_PATH, ttl=DEFAULT_CACHE_TTL):
+      self.inventory = platform.getInventory()
+      self.path = path
+      self.cache = StateCache(ttl)
+      # serializes the hardware writes, reads run concurrently
+      self.writeLock = threading.Lock()
+      self.leds = {}
+      self.sock = None
+      self.clientsLock = threading.Lock()
+      self.clients = []
+      self.handlers = {
+         OP_INVENTORY: self.handleInventory,
+         OP_XCVR_PRESENCE: self.handleXcvrPresence,
+         OP_XCVR_LPMODE: self.handleXcvrLowPowerMode,
+         OP_XCVR_SET_LPMODE: self.handleXcvrSetLowPowerMode,
+         OP_XCVR_RESET: self.handleXcvrReset,
+         OP_PSU_STATUS: self.handlePsuStatus,
+         OP_LED_SET: self.handleLedSet,
+      }
+
+   def describeInventory(self):
+      inventory = self.inventory
+      return {
+         'portStart': inventory.portStart,
+         'portEnd': inventory.portEnd,
+         'sfpRange': list(inventory.sfpRange),
+         'qsfpRange': list(inventory.qsfpRange),
+         'eeproms': inventory.getPortToEepromMapping(),
+         'buses': inventory.getPortToI2cAdapterMapping(),
+         'xcvrLeds': dict(inventory.xcvrLeds),
+         'statusLeds': inventory.statusLeds,
+         'numPsus': inventory.getNumPsus(),
+      }
+
+   def requestedPorts(self, payload):
+      ports = [port for port, in unpackRecords(PORT, payload)]
+      return ports or sorted(self.inventory.getXcvrs().keys())
+
+   def handleInventory(self, payload):
+      return json.dumps(self.describeInventory()).encode()
+
+   def handleXcvrPresence(self, payload):
+      xcvrs = self.inventory.getXcvrs()
+      return packRecords(PORT_VALUE, [
+         (port, self.cache.get(('present', port), xcvrs[port].getPresence))
+         for port in self.requestedPorts(payload)
+      ])
+
+   def handleXcvrLowPowerMode(self, payload):
+      xcvrs = self.inventory.getXcvrs()
+      return packRecords(PORT_VALUE, [
+         (port, self.cache.get(('lp_mode', port), xcvrs[port].getLowPowerMode))
+         for port in self.requestedPorts(payload)
+      ])
+
+   def handleXcvrSetLowPowerMode(self, payload):
+      xcvrs = self.inventory.getXcvrs()
+      results = []
+      with self.writeLock:
+         for port, value in unpackRecords(PORT_VALUE, payload):
+            self.cache.invalidate(('lp_mode', port))
+            results.append((port, bool(xcvrs[port].setLowPowerMode(bool(value)))))
+      return packRecords(PORT_VALUE, results)
+
+   def handleXcvrReset(self, payload):
+      xcvrs = self.inventory.getXcvrs()
+      results = []
+      with self.writeLock:
+         for port, value in unpackRecords(PORT_VALUE, payload):
+            self.cache.invalidate(('present', port), ('lp_mode', port))
+            results.append((port, bool(xcvrs[port].reset(bool(value)))))
+      return packRecords(PORT_VALUE, results)
+
+   def handlePsuStatus(self, payload):
+      records = []
+      for index in range(self.inventory.getNumPsus()):
+         psu = self.inventory.getPsu(index)
+         records.append((index,
+                         self.cache.get(('psu_present', index), psu.getPresence),
+                         self.cache.get(('psu_status', index), psu.getStatus)))
+      return packRecords(PSU_STATUS, records)
+
+   def handleLedSet(self, payload):
+      # only the leds whose value changed are written
+      with self.writeLock:
+         leds = dict((name, value) for name, value in unpackLeds(payload).items()
+                     if self.leds.get(name) != value)
+         self.inventory.setLeds(leds)
+         self.leds.update(leds)
+      return b''
+
+   def handle(self, client):
+      """Serves one request, returns False once the client is gone."""
+      try:
+         op, _, payload = recvMessage(client)
+      except (EOFError, ValueError, socket.error):
+         return False
+
+      handler = self.handlers.get(op)
+      try:
+         if handler is None:
+            raise ValueError('unknown op %d' % op)
+         status, response = STATUS_OK, handler(payload)
+      except Exception as e:
+         logging.error('request %d failed: %s', op, e)
+         status, response = STATUS_ERROR, str(e).encode()
+
+      try:
+         sendMessage(client, op, status, response)
+      except socket.error:
+         return False
+      return True
+
+   def serve(self, client):
+      try:
+         while True:
+            # idle clients are fine, the timeout only applies within a message
+            select.select([client], [], [])
+            if not self.handle(client):
+               break
+      except (select.error, socket.error):
+         pass
+      finally:
+         self.disconnect(client)
+
+   def disconnect(self, client):
+      with self.clientsLock:
+         if client not in self.clients:
+            return
+         self.clients.remove(client)
+      client.close()
+
+   def handleUevent(self, event):
+      kinds = UEVENT_INVALIDATIONS.get(event.get('SUBSYSTEM'))
+      if kinds:
+         self.cache.invalidateKinds(kinds)
+
+   def listen(self):
+      try:
+         os.unlink(self.path)
+      except OSError as e:
+         if e.errno != errno.ENOENT:
+            raise
+      self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+      self.sock.bind(self.path)
+      self.sock.listen(16)
+      logging.info('platform daemon listening on %s', self.path)
+
+   def run(self):
+      if not addUeventListener(self.handleUevent):
+         logging.info('no uevents, the cache only expires after its ttl')
+      self.listen()
+      try:
+         while True:
+            client, _ = self.sock.accept()
+            # a stuck client must not hang its thread
+            client.settimeout(CLIENT_TIMEOUT)
+            with self.clientsLock:
+               self.clients.append(client)
+            thread = threading.Thread(target=self.serve, args=(client,))
+            thread.daemon = True
+            thread.start()
+      finally:
+         with self.clientsLock:
+            clients = list(self.clients)
+         for client in clients:
+            self.disconnect(client)
+         self.sock.close()
+         os.unlink(self.path)
+
+class DaemonError(Exception):
+   pass
+
+class DaemonClient(object):
+   def __init__(self, path=SOCKET_PATH, timeout=REQUEST_TIMEOUT,
+                retries=REQUEST_RETRIES):
+      self.path = path
+      self.timeout = timeout
+      self.retries = retries
+      self.sock = None
+      self.connect()
+
+   def connect(self):
+      sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+      sock.settimeout(self.timeout)
+      try:
+         sock.connect(self.path)
+      except socket.error:
+         sock.close()
+         raise
+      self.sock = sock
+
+   def close(self):
+      if self.sock is not None:
+         self.sock.close()
+         self.sock = None
+
+   def request(self, op, payload=b''):
+      # a connection that failed mid request is out of sync, start a new one
+      attempt = 0
+      while True:
+         try:
+            if self.sock is None:
+               self.connect()
+            sendMessage(self.sock, op, STATUS_OK, payload)
+            rop, status, response = recvMessage(self.sock)
+            break
+         except (socket.error, EOFError, ValueError) as e:
+            self.close()
+            if attempt >= self.retries:
+               raise
+            attempt += 1
+            logging.debug('request %d to %s failed, reconnecting: %s', op,
+                          self.path, e)
+            time.sleep(RECONNECT_DELAY)
+
+      if rop != op or status != STATUS_OK:
+         raise DaemonError('request %d failed: %s' % (op, response))
+      return response
+
+   def inventory(self):
+      return json.loads(self.request(OP_INVENTORY).decode())
+
+   def xcvrPresence(self, ports=None):
+      payload = packRecords(PORT, [(port,) for port in ports or []])
+      response = self.request(OP_XCVR_PRESENCE, payload)
+      return dict((port, bool(v)) for port, v in unpackRecords(PORT_VALUE, response))
+
+   def xcvrLowPowerMode(self, ports=None):
+      payload = packRecords(PORT, [(port,) for port in ports or []])
+      response = self.request(OP_XCVR_LPMODE, payload)
+      return dict((port, bool(v)) for port, v in unpackRecords(PORT_VALUE, response))
+
+   def setXcvrLowPowerMode(self, values):
+      payload = packRecords(PORT_VALUE, [(p, int(v)) for p, v in values.items()])
+      response = self.request(OP_XCVR_SET_LPMODE, payload)
+      return dict((port, bool(v)) for port, v in unpackRecords(PORT_VALUE, response))
+
+   def resetXcvr(self, values):
+      payload = packRecords(PORT_VALUE, [(p, int(v)) for p, v in values.items()])
+      response = self.request(OP_XCVR_RESET, payload)
+      return dict((port, bool(v)) for port, v in unpackRecords(PORT_VALUE, response))
+
+   def psuStatus(self):
+      response = self.request(OP_PSU_STATUS)
+      return [(bool(presence), bool(status))
+              for _, presence, status in unpackRecords(PSU_STATUS, response)]
+
+   def setLeds(self, leds):
+      self.request(OP_LED_SET, packLeds(leds))
+
+class RemoteXcvr(object):
+   def __init__(self, client, portNum):
+      self.client = client
+      self.portNum = portNum
+
+   def getPresence(self):
+      return self.client.xcvrPresence([self.portNum])[self.portNum]
+
+   def getLowPowerMode(self):
+      return self.client.xcvrLowPowerMode([self.portNum])[self.portNum]
+
+   def setLowPowerMode(self, value):
+      return self.client.setXcvrLowPowerMode({self.portNum: value})[self.portNum]
+
+   def reset(self, value):
+      return self.client.resetXcvr({self.portNum: value})[self.portNum]
+
+class RemotePsu(object):
+   def __init__(self, client, index):
+      self.client = client
+      self.index = index
+
+   def getPresence(self):
+      return self.client.psuStatus()[self.index][0]
+
+   def getStatus(self):
+      return self.client.psuStatus()[self.index][1]
+
+class RemoteInventory(object):
+   """Inventory look alike answering from the platform daemon."""
+   def __init__(self, client):
+      self.client = client
+      info = client.inventory()
+      # json turns the integer keys into strings
+      intKeys = lambda d: dict((int(k), v) for k, v in d.items())
+      self.portStart = info['portStart']
+      self.portEnd = info['portEnd']
+      self.sfpRange = info['sfpRange']
+      self.qsfpRange = info['qsfpRange']
+      self.allXcvrsRange = sorted(self.sfpRange + self.qsfpRange)
+      self.eeproms = intKeys(info['eeproms'])
+      self.buses = intKeys(info['buses'])
+      self.xcvrLeds = intKeys(info['xcvrLeds'])
+      self.statusLeds = info['statusLeds']
+      self.xcvrs = dict((port, RemoteXcvr(client, port)) for port in self.eeproms)
+      self.psus = [RemotePsu(client, i) for i in range(info['numPsus'])]
+
+   def getXcvrs(self):
+      return self.xcvrs
+
+   def getXcvr(self, xcvrId):
+      return self.xcvrs[xcvrId]
+
+   def getPortToEepromMapping(self):
+      return self.eeproms
+
+   def getPortToI2cAdapterMapping(self):
+      return self.buses
+
+   def getPsu(self, index):
+      return self.psus[index]
+
+   def getNumPsus(self):
+      return len(self.psus)
+
+   def setLeds(self, leds):
+      self.client.setLeds(leds)
+
+def getInventory(path=SOCKET_PATH):
+   try:
+      return RemoteInventory(DaemonClient(path))
+   except (socket.error, EOFError, DaemonError) as e:
+      logging.debug('platform daemon unavailable, building the platform: %s', e)
+
+   from platform import getPlatform
+   return getPlatform().getInventory()
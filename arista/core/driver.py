@@ -3,10 +3,13 @@ from __future__ import print_function
 import logging
 import os
 import subprocess
-import time
 
+from profiler import profile
+from uevent import waitForPath
 from utils import inDebug, inSimulation
 
+WAIT_FILE_TIMEOUT = 1
+
 def modprobe(name, args=None):
    logging.debug('loading module %s', name)
    if args is None:
@@ -17,15 +20,84 @@ def modprobe(name, args=None):
    if inSimulation():
       logging.debug('exec: %s', ' '.join(args))
    else:
-      subprocess.check_call(args)
+      with profile('modprobe', name):
+         subprocess.check_call(args)
+
+def uniqueModules(names):
+   modules = []
+   for name in names:
+      name = name.replace('-', '_')
+      if name not in modules:
+         modules.append(name)
+   return modules
+
+def modprobeAll(names):
+   # modprobe -a does not take module parameters, modules that need some are
+   # left to their driver and so is everything when the debug parameters have
+   # to be passed
+   if inDebug():
+      return
+   modules = uniqueModules(names)
+   if not modules:
+      return
+   # a missing alias should not prevent the actual modules from being loaded
+   modules.sort(key=lambda name: ':' in name)
+   logging.debug('loading modules %s', ', '.join(modules))
+   args = ['modprobe', '-a'] + modules
+   if inSimulation():
+      logging.debug('exec: %s', ' '.join(args))
+      return
+   try:
+      with profile('modprobe', ' '.join(modules)):
+         subprocess.check_call(args)
+   except subprocess.CalledProcessError as e:
+      # the drivers will load what is missing one by one
+      logging.warn('failed to load some of the modules: %s', e)
+
+unloadBatch = None
 
 def rmmod(name):
+   if unloadBatch is not None:
+      logging.debug('deferring unload of module %s', name)
+      unloadBatch.append(name)
+      return
    logging.debug('unloading module %s', name)
    args = ['modprobe', '-r', name.replace('-', '_')]
    if inSimulation():
       logging.debug('exec: %s', ' '.join(args))
    else:
-      subprocess.check_call(args)
+      with profile('rmmod', name):
+         subprocess.check_call(args)
+
+def rmmodAll(names):
+   modules = uniqueModules(names)
+   if not modules:
+      return
+   logging.debug('unloading modules %s', ', '.join(modules))
+   args = ['modprobe', '-r', '-a'] + modules
+   if inSimulation():
+      logging.debug('exec: %s', ' '.join(args))
+   else:
+      with profile('rmmod', ' '.join(modules)):
+         subprocess.check_call(args)
+
+class BatchUnload(object):
+   """Defers the rmmod calls made in its scope to a single modprobe -r -a.
+
+   Modules are unloaded in the order the calls were made, which keeps the
+   dependent modules going first.
+   """
+   def __enter__(self):
+      global unloadBatch
+      unloadBatch = []
+
+   def __exit__(self, exc_type, exc_val, traceback):
+      global unloadBatch
+      modules, unloadBatch = unloadBatch, None
+      try:
+         rmmodAll(modules)
+      except Exception as e:
+         logging.error('Failed to unload %s: %s', ', '.join(modules), e)
 
 def isModuleLoaded(name):
    with open('/proc/modules') as f:
@@ -45,6 +117,9 @@ class Driver(object):
    def finish(self):
       pass
 
+   def getKernelModules(self):
+      return []
+
    def clean(self):
       pass
 
@@ -67,26 +142,26 @@ class KernelDriver(Driver):
       self.args = args if args is not None else []
       self.waitFile = waitFile
 
-   def waitFileReady(self):
+   def waitFileReady(self, timeout=WAIT_FILE_TIMEOUT):
       if not self.waitFile:
          return
 
       logging.debug('Starting driver. Waiting file %s.', self.waitFile)
-
-      count = 0
-      while not os.path.exists(self.waitFile) and count <= 20:
-         time.sleep(0.05)
-         count = count + 1
-         logging.debug('Starting driver. Waiting file %s attempt %d.',
-                       self.waitFile, count)
-      if not os.path.exists(self.waitFile):
+      if not waitForPath(self.waitFile, timeout):
          logging.error('Starting driver. Waiting file %s failed.',
                        self.waitFile)
 
    def setup(self):
-      modprobe(self.module, self.args)
+      # the module may already have been loaded along with the others
+      if inSimulation() or not self.loaded():
+         modprobe(self.module, self.args)
       self.waitFileReady()
 
+   def getKernelModules(self):
+      if self.module is None or self.args:
+         return []
+      return [self.module]
+
    def clean(self):
       if self.loaded():
          try:
@@ -1,5 +1,7 @@
 from collections import defaultdict
 
+from ledbank import LedBank
+
 class Xcvr(object):
 
    SFP = 0
@@ -31,6 +33,8 @@ class Psu(object):
       raise NotImplementedError()
 
 class Inventory(object):
+   LED_SYSFS_PATH = '/sys/class/leds/{0}/brightness'
+
    def __init__(self):
       self.sfpRange = []
       self.qsfpRange = []
@@ -43,6 +47,7 @@ class Inventory(object):
 
       self.xcvrLeds = defaultdict(list)
       self.statusLeds = []
+      self.ledBank = LedBank()
 
       self.psus = []
 
@@ -88,6 +93,13 @@ class Inventory(object):
    def addStatusLeds(self, names):
       self.statusLeds.extend(names)
 
+   def setLeds(self, leds):
+      # leds of the scds are all set with a single write, others one by one
+      leds = self.ledBank.setLeds(leds)
+      for name, value in leds.items():
+         with open(self.LED_SYSFS_PATH.format(name), 'w') as fp:
+            fp.write('%d' % value)
+
    def addPsus(self, psus):
       self.psus = psus
 
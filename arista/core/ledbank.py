@@ -0,0 +1,127 @@
+import logging
+import os
+import struct
+
+from collections import defaultdict
+
+LED_CLASS_PATH = '/sys/class/leds'
+
+class LedBank(object):
+   """Sets the color of many leds with one write per scd.
+
+   scd-hwmon lists its leds in led_names and takes (index, color) records on
+   led_bank, see struct scd_led_bank_entry. Leds that do not belong to an scd
+   are left to the caller.
+   """
+   ENTRY = struct.Struct('<HBB')
+   NETDEV_TRIGGER = 'scd-netdev'
+   # each write to a sysfs attribute is limited to a page
+   NETDEV_CHUNK_SIZE = 4000
+
+   def __init__(self, classPath=LED_CLASS_PATH):
+      self.classPath = classPath
+      self.leds = None
+      self.devices = set()
+
+   def _load(self):
+      self.leds = {}
+      self.devices = set()
+      if not os.path.isdir(self.classPath):
+         return
+      devices = set()
+      for name in os.listdir(self.classPath):
+         devices.add(os.path.realpath(os.path.join(self.classPath, name, 'device')))
+      for device in devices:
+         path = os.path.join(device, 'led_names')
+         if not os.path.exists(path):
+            continue
+         with open(path) as f:
+            for index, name in enumerate(f.read().splitlines()):
+               self.leds[name] = (device, index)
+         self.devices.add(device)
+
+   def _getLeds(self):
+      # the leds may not be registered yet, or their scd got unbound and probed
+      # again, only keep a map that still points at existing banks
+      if not self.leds or any(not os.path.exists(os.path.join(device, 'led_bank'))
+                              for device in self.devices):
+         self._load()
+      return self.leds
+
+   def _banks(self, leds):
+      banks = defaultdict(list)
+      remaining = {}
+      for name, value in leds.items():
+         if name in self.leds:
+            device, index = self.leds[name]
+            banks[device].append(self.ENTRY.pack(index, value, 0))
+         else:
+            remaining[name] = value
+      return banks, remaining
+
+   def _writeBanks(self, banks):
+      for device, entries in banks.items():
+         logging.debug('setting %d leds of %s', len(entries), device)
+         with open(os.path.join(device, 'led_bank'), 'wb') as f:
+            f.write(b''.join(entries))
+
+   def setLeds(self, leds):
+      """Returns the leds that could not be set through a led bank."""
+      self._getLeds()
+      banks, remaining = self._banks(leds)
+      try:
+         self._writeBanks(banks)
+      except (IOError, OSError) as e:
+         # the indexes are stale if the device changed under us, try once more
+         # with a fresh map
+         logging.debug('led bank write failed, reloading the leds: %s', e)
+         self._load()
+         banks, remaining = self._banks(leds)
+         self._writeBanks(banks)
+      return remaining
+
+   def bindNetdevs(self, bindings):
+      """Binds leds to netdevs given as {led: (ifname, linkColor)}.
+
+      Returns the names of the leds now driven by the kernel on carrier changes.
+      """
+      self._getLeds()
+      try:
+         return self._bindNetdevs(bindings)
+      except (IOError, OSError) as e:
+         logging.debug('led netdev binding failed, reloading the leds: %s', e)
+         self._load()
+         return self._bindNetdevs(bindings)
+
+   def _bindNetdevs(self, bindings):
+      banks = defaultdict(list)
+      for name, (ifname, color) in bindings.items():
+         if name in self.leds:
+            device, _ = self.leds[name]
+            banks[device].append('%s %s %d\n' % (name, ifname, color))
+
+      bound = set()
+      for device, lines in banks.items():
+         path = os.path.join(device, 'led_netdev')
+         if not os.path.exists(path):
+            continue
+         logging.debug('binding %d leds of %s to netdevs', len(lines), device)
+         fd = os.open(path, os.O_WRONLY)
+         try:
+            chunk = ''
+            for line in lines:
+               if len(chunk) + len(line) > self.NETDEV_CHUNK_SIZE:
+                  os.write(fd, chunk.encode())
+                  chunk = ''
+               chunk += line
+            os.write(fd, chunk.encode())
+         finally:
+            os.close(fd)
+         for line in lines:
+            bound.add(line.split()[0])
+
+      for name in bound:
+         with open(os.path.join(self.classPath, name, 'trigger'), 'w') as f:
+            f.write(self.NETDEV_TRIGGER)
+
+      return bound
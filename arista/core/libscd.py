@@ -0,0 +1,97 @@
+import ctypes
+import ctypes.util
+import logging
+
+# Python bindings of lib/libscd.so, direct access to the scd registers through
+# the mmap'd resource0 of the pci device
+
+LIBSCD_NAMES = ['libscd.so', 'libscd.so.0']
+
+class ScdHandle(ctypes.Structure):
+   _fields_ = [
+      ('mem', ctypes.c_void_p),
+      ('size', ctypes.c_size_t),
+   ]
+
+libscd = None
+def loadLibScd():
+   global libscd
+
+   if libscd is not None:
+      return libscd
+
+   for name in LIBSCD_NAMES + [ctypes.util.find_library('scd')]:
+      if not name:
+         continue
+      try:
+         lib = ctypes.CDLL(name, use_errno=True)
+         break
+      except OSError:
+         continue
+   else:
+      raise OSError('libscd not found')
+
+   handle = ctypes.POINTER(ScdHandle)
+   u32 = ctypes.c_uint32
+   prototypes = {
+      'scd_open': (ctypes.c_int, [handle, ctypes.c_char_p]),
+      'scd_close': (None, [handle]),
+      'scd_gpio_get': (ctypes.c_int, [handle, u32, ctypes.c_uint, ctypes.c_int]),
+      'scd_gpio_set': (ctypes.c_int, [handle, u32, ctypes.c_uint, ctypes.c_int,
+                                      ctypes.c_int]),
+      'scd_gpio_get_mask': (u32, [handle, u32, u32, u32]),
+      'scd_reset_get': (ctypes.c_int, [handle, u32, ctypes.c_uint]),
+      'scd_reset_set': (None, [handle, u32, ctypes.c_uint, ctypes.c_int]),
+      'scd_led_set': (None, [handle, u32, ctypes.c_uint]),
+      'scd_led_get': (u32, [handle, u32]),
+   }
+   for name, (restype, argtypes) in prototypes.items():
+      func = getattr(lib, name)
+      func.restype = restype
+      func.argtypes = argtypes
+
+   libscd = lib
+   return lib
+
+class LibScd(object):
+   def __init__(self, devpath):
+      self.devpath = devpath
+      self.lib = loadLibScd()
+      self.handle = ScdHandle()
+      err = self.lib.scd_open(ctypes.byref(self.handle), devpath.encode())
+      if err < 0:
+         raise OSError(-err, 'failed to map scd registers of %s' % devpath)
+      logging.debug('mapped %d bytes of scd registers of %s', self.handle.size,
+                    devpath)
+
+   def __del__(self):
+      self.close()
+
+   def close(self):
+      if getattr(self, 'handle', None) and self.handle.mem:
+         self.lib.scd_close(ctypes.byref(self.handle))
+
+   def gpioGet(self, addr, bit, activeLow=False):
+      return self.lib.scd_gpio_get(ctypes.byref(self.handle), addr, bit,
+                                   int(activeLow))
+
+   def gpioSet(self, addr, bit, value, activeLow=False):
+      err = self.lib.scd_gpio_set(ctypes.byref(self.handle), addr, bit,
+                                  int(activeLow), int(value))
+      return err == 0
+
+   def gpioGetMask(self, addr, mask, activeLowMask=0):
+      return self.lib.scd_gpio_get_mask(ctypes.byref(self.handle), addr, mask,
+                                        activeLowMask)
+
+   def resetGet(self, addr, bit):
+      return self.lib.scd_reset_get(ctypes.byref(self.handle), addr, bit)
+
+   def resetSet(self, addr, bit, value):
+      self.lib.scd_reset_set(ctypes.byref(self.handle), addr, bit, int(value))
+
+   def ledSet(self, addr, brightness):
+      self.lib.scd_led_set(ctypes.byref(self.handle), addr, brightness)
+
+   def ledGet(self, addr):
+      return self.lib.scd_led_get(ctypes.byref(self.handle), addr)
@@ -9,16 +9,24 @@ from collections import OrderedDict, namedtuple, defaultdict
 
 from inventory import Inventory
 from component import Component, Priority
+from profiler import profile
+from scheduler import DEFAULT_SETUP_WORKERS
 from utils import simulateWith
-from driver import modprobe, rmmod, KernelDriver
+from driver import modprobe, modprobeAll, rmmod, BatchUnload, KernelDriver
 
 import prefdl
 
+from arista.platforms import importPlatform, importAllPlatforms
+
 platforms = {}
 syseeprom = None
 
 host_prefdl_path = '/host/.system-prefdl'
 fmted_prefdl_path = '/etc/sonic/.syseeprom'
+prefdl_bus = 1
+prefdl_addr = 0x52
+prefdl_sysfs_path = '/sys/bus/i2c/drivers/prefdl-eeprom/%d-%04x' % (prefdl_bus,
+                                                                    prefdl_addr)
 
 def formatPrefdlData(data):
    formatDict = {
@@ -43,7 +51,40 @@ def writeFormattedPrefdl(pfdl, f):
       for k, v in fdata.items():
          fp.write("%s: %s\n" % (k, v))
 
+def readPrefdlFromKernel():
+   if not os.path.exists(prefdl_sysfs_path):
+      return None
+   logging.debug('reading system eeprom from %s', prefdl_sysfs_path)
+   return prefdl.PreFdlFromSysfs(prefdl_sysfs_path)
+
+def loadPrefdlDriver():
+   modprobe('prefdl-eeprom')
+   busPath = '/sys/bus/i2c/devices/i2c-%d' % prefdl_bus
+   devicePath = '/sys/bus/i2c/devices/%d-%04x' % (prefdl_bus, prefdl_addr)
+   if not os.path.exists(busPath):
+      return
+   if not os.path.exists(devicePath):
+      with open(os.path.join(busPath, 'new_device'), 'w') as f:
+         f.write('prefdl 0x%02x' % prefdl_addr)
+   if os.path.exists(prefdl_sysfs_path):
+      return
+
+   # the probe failed (crc, unknown version), a prefdl device left behind would
+   # keep the eeprom driver of the fallback from binding to the address
+   with open(os.path.join(devicePath, 'name')) as f:
+      name = f.read().strip()
+   if name != 'prefdl':
+      return
+   logging.warn('prefdl-eeprom did not bind to %s, removing it', devicePath)
+   with open(os.path.join(busPath, 'delete_device'), 'w') as f:
+      f.write('0x%02x' % prefdl_addr)
+
 def readPrefdl():
+   # decoded once by the kernel driver, this is just a few small reads
+   pfdl = readPrefdlFromKernel()
+   if pfdl is not None:
+      return pfdl
+
    if os.path.exists(fmted_prefdl_path):
       with open(fmted_prefdl_path) as fp:
          logging.debug('reading system eeprom from %s', fmted_prefdl_path)
@@ -57,6 +98,15 @@ def readPrefdl():
       with open(fmted_prefdl_path) as fp:
          return prefdl.PreFdlFromFile(fp)
 
+   try:
+      loadPrefdlDriver()
+      pfdl = readPrefdlFromKernel()
+      if pfdl is not None:
+         pfdl.writeToFile(fmted_prefdl_path)
+         return pfdl
+   except Exception as e:
+      logging.warn('could not load the prefdl eeprom driver: %s', e)
+
    modprobe('eeprom')
    for addr in ['1-0052']:
       eeprompath = os.path.join('/sys/bus/i2c/drivers/eeprom', addr, 'eeprom')
@@ -94,9 +144,13 @@ def detectPlatform():
 def getPlatform(name=None):
    if name == None:
       name = detectPlatform()
+   # only the module defining this sku is imported
+   if name not in platforms and not importPlatform(name):
+      importAllPlatforms()
    return platforms[name]()
 
 def getPlatforms():
+   importAllPlatforms()
    return platforms
 
 def registerPlatform(skus):
@@ -113,13 +167,20 @@ def registerPlatform(skus):
 class Platform(Component):
    def __init__(self):
       super(Platform, self).__init__()
-      self.addDriver(KernelDriver, 'eeprom')
+      self.addDriver(KernelDriver, 'prefdl-eeprom')
       self.addDriver(KernelDriver, 'i2c-dev')
       self.inventory = Inventory()
 
-   def setup(self, priority=Priority.DEFAULT):
-      super(Platform, self).setup()
-      super(Platform, self).finish(priority)
+   def setup(self, priority=Priority.DEFAULT, workers=DEFAULT_SETUP_WORKERS):
+      with profile('platform', 'setup priority %d' % priority):
+         # load every module needed at this priority with a single modprobe
+         modprobeAll(self.getKernelModules(priority))
+         super(Platform, self).setup()
+         super(Platform, self).finish(priority, workers)
+
+   def clean(self):
+      with BatchUnload():
+         super(Platform, self).clean()
 
    def getInventory(self):
       return self.inventory
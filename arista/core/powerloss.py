@@ -0,0 +1,71 @@
+import datetime
+import logging
+import struct
+
+# Decoder for the record left by the scd driver in reserved memory when a power
+# loss interrupt fires, see struct scd_powerloss_record in src/scd.h
+
+POWERLOSS_PATH = '/proc/scd_powerloss'
+
+POWERLOSS_MAGIC = 0x50444353
+POWERLOSS_VERSION = 1
+
+recordFormat = '<IHHIIQQIIIIQQ'
+recordFields = [
+   'magic',
+   'version',
+   'size',
+   'count',
+   'irq_reg',
+   'ptp_timestamp',
+   'realtime_ns',
+   'status',
+   'mask',
+   'revision',
+   'pci_id',
+   'interrupts',
+   'reserved',
+]
+
+def decodePowerlossRecord(data):
+   size = struct.calcsize(recordFormat)
+   if len(data) < size:
+      return None
+
+   record = dict(zip(recordFields, struct.unpack(recordFormat, data[:size])))
+   if record['magic'] != POWERLOSS_MAGIC:
+      logging.debug('invalid power loss record magic 0x%08x', record['magic'])
+      return None
+   if record['version'] != POWERLOSS_VERSION or record['size'] != size:
+      logging.debug('unsupported power loss record version %d size %d',
+                    record['version'], record['size'])
+      return None
+
+   return record
+
+def readPowerlossRecord(path=POWERLOSS_PATH):
+   try:
+      with open(path, 'rb') as f:
+         data = f.read()
+   except IOError:
+      logging.debug('no power loss record available at %s', path)
+      return None
+
+   return decodePowerlossRecord(data)
+
+def formatPowerlossRecord(record):
+   seconds = record['realtime_ns'] // 1000000000
+   nsecs = record['realtime_ns'] % 1000000000
+   date = datetime.datetime.utcfromtimestamp(seconds)
+   pciId = record['pci_id']
+   return [
+      ('time', '%s.%09d UTC' % (date.strftime('%Y-%m-%d %H:%M:%S'), nsecs)),
+      ('ptp timestamp', '%d' % record['ptp_timestamp']),
+      ('scd', '%02x:%02x.%d' % (pciId >> 8, (pciId >> 3) & 0x1f, pciId & 0x7)),
+      ('scd revision', '0x%x' % record['revision']),
+      ('interrupt register', '%d' % record['irq_reg']),
+      ('interrupt status', '0x%08x' % record['status']),
+      ('interrupt mask', '0x%08x' % record['mask']),
+      ('power loss interrupts', '%d' % record['count']),
+      ('interrupts', '%d' % record['interrupts']),
+   ]
@@ -15,6 +15,7 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+import os
 import re
 import struct
 import sys
@@ -203,6 +204,44 @@ class PreFdlFromFile():
    def getCrc(self):
       return self.crc
 
+class PreFdlFromSysfs():
+   # decoded by the prefdl-eeprom kernel driver, fields are sysfs attributes
+   attributes = {
+      'SKU': 'sku',
+      'MAC': 'mac',
+      'SerialNumber': 'serial_number',
+   }
+
+   def __init__(self, path):
+      self._data = {}
+      for key, attr in self.attributes.items():
+         try:
+            with open(os.path.join(path, attr)) as fp:
+               self._data[key] = fp.read().strip()
+         except IOError:
+            # the field is not in the prefdl
+            pass
+      with open(os.path.join(path, 'crc')) as fp:
+         self.crc = fp.read().strip()
+
+   def data(self):
+      return self._data
+
+   def show(self):
+      for key, val in self._data.items():
+         print("%s: %s" % (key, val))
+
+   def writeToFile(self, f):
+      with open(f, 'w+') as fp:
+         for k, v in self._data.items():
+            fp.write("%s: %s\n" % (k, v))
+
+   def getField(self, name):
+      return self._data[name]
+
+   def getCrc(self):
+      return self.crc
+
 def decode( fp ):
    data = fp.read( 4 )
    data = data.strip()
@@ -0,0 +1,127 @@
+from __future__ import print_function
+
+import ctypes
+import json
+import os
+import threading
+
+try:
+   from time import monotonic
+except ImportError:
+   CLOCK_MONOTONIC = 1
+
+   class timespec(ctypes.Structure):
+      _fields_ = [('tv_sec', ctypes.c_long), ('tv_nsec', ctypes.c_long)]
+
+   librt = ctypes.CDLL('librt.so.1', use_errno=True)
+
+   def monotonic():
+      ts = timespec()
+      if librt.clock_gettime(CLOCK_MONOTONIC, ctypes.byref(ts)) != 0:
+         errno = ctypes.get_errno()
+         raise OSError(errno, os.strerror(errno))
+      return ts.tv_sec + ts.tv_nsec * 1e-9
+
+class NullSpan(object):
+   def __enter__(self):
+      pass
+
+   def __exit__(self, exc_type, exc_val, traceback):
+      pass
+
+class Span(object):
+   def __init__(self, profiler, category, name, args):
+      self.profiler = profiler
+      self.category = category
+      self.name = name
+      self.args = args
+      self.start = None
+
+   def __enter__(self):
+      self.start = monotonic()
+
+   def __exit__(self, exc_type, exc_val, traceback):
+      end = monotonic()
+      if exc_type is not None:
+         self.args['error'] = str(exc_val)
+      self.profiler.addEvent(self.category, self.name, self.start,
+                             end - self.start, self.args)
+
+class Profiler(object):
+   """Records how long each step of the platform setup takes.
+
+   Steps are timed with the monotonic clock and kept in memory until they are
+   written as a chrome trace (chrome://tracing, ui.perfetto.dev) or summarized.
+   Profiling is disabled by default and spans are then no-ops.
+   """
+   def __init__(self):
+      self.enabled = False
+      self.lock = threading.Lock()
+      self.events = []
+      self.threads = {}
+      self.origin = None
+
+   def enable(self):
+      self.enabled = True
+      self.origin = monotonic()
+
+   def span(self, category, name, **args):
+      if not self.enabled:
+         return NullSpan()
+      return Span(self, category, str(name), args)
+
+   def addEvent(self, category, name, start, duration, args=None):
+      if not self.enabled:
+         return
+      thread = threading.current_thread()
+      pid = os.getpid()
+      with self.lock:
+         self.threads[(pid, thread.ident)] = thread.name
+         self.events.append({
+            'name': name,
+            'cat': category,
+            'ph': 'X',
+            'ts': (start - self.origin) * 1e6,
+            'dur': duration * 1e6,
+            'pid': pid,
+            'tid': thread.ident,
+            'args': args or {},
+         })
+
+   def addKernelEvent(self, name, durationNs, **args):
+      # the kernel only reports a duration, it is assumed to have just ended
+      duration = durationNs * 1e-9
+      self.addEvent('kernel', name, monotonic() - duration, duration, args)
+
+   def writeTrace(self, path):
+      with self.lock:
+         events = list(self.events)
+         threads = dict(self.threads)
+      for (pid, tid), name in threads.items():
+         events.append({
+            'name': 'thread_name',
+            'ph': 'M',
+            'pid': pid,
+            'tid': tid,
+            'args': {'name': name},
+         })
+      with open(path, 'w') as f:
+         json.dump({'traceEvents': events, 'displayTimeUnit': 'ms'}, f)
+
+   def summary(self, count=20):
+      with self.lock:
+         events = sorted(self.events, key=lambda e: e['dur'], reverse=True)
+      lines = ['%10s  %-10s %s' % ('time (ms)', 'step', 'name')]
+      for event in events[:count]:
+         name = event['name']
+         component = event['args'].get('component')
+         if component:
+            name = '%s on %s' % (name, component)
+         lines.append('%10.2f  %-10s %s' % (event['dur'] / 1e3, event['cat'],
+                                            name))
+      return '\n'.join(lines)
+
+profiler = Profiler()
+
+def profile(category, name, **args):
+   return profiler.span(category, name, **args)
@@ -0,0 +1,91 @@
+import logging
+import threading
+import traceback
+
+from collections import deque
+
+DEFAULT_SETUP_WORKERS = 8
+
+class Task(object):
+   def __init__(self, func, args):
+      self.func = func
+      self.args = args
+      self.pending = 0
+      self.dependents = []
+
+   def __str__(self):
+      return str(self.func)
+
+class Scheduler(object):
+   """Runs a graph of tasks on a bounded pool of worker threads.
+
+   A task added with add() only gets queued once every task it depends on has
+   completed. run() returns once the queue is drained and no task is running
+   anymore. The first failure stops the scheduling of new tasks and is raised
+   back to the caller.
+   """
+   def __init__(self, workers=DEFAULT_SETUP_WORKERS):
+      self.workers = max(1, workers)
+      self.cond = threading.Condition()
+      self.tasks = deque()
+      self.running = 0
+      self.error = None
+
+   def add(self, func, *args, **kwargs):
+      task = Task(func, args)
+      for dep in kwargs.get('after', []):
+         task.pending += 1
+         dep.dependents.append(task)
+      if not task.pending:
+         self.tasks.append(task)
+      return task
+
+   def _next(self):
+      with self.cond:
+         while not self.tasks and self.running and self.error is None:
+            self.cond.wait()
+         if self.error is not None or not self.tasks:
+            self.cond.notify_all()
+            return None
+         self.running += 1
+         return self.tasks.popleft()
+
+   def _done(self, task, error=None):
+      with self.cond:
+         if error is not None and self.error is None:
+            self.error = error
+         if error is None:
+            for dependent in task.dependents:
+               dependent.pending -= 1
+               if not dependent.pending:
+                  self.tasks.append(dependent)
+         self.running -= 1
+         self.cond.notify_all()
+
+   def _worker(self):
+      while True:
+         task = self._next()
+         if task is None:
+            return
+         try:
+            task.func(*task.args)
+         except Exception as e:
+            logging.debug('task %s failed: %s', task, traceback.format_exc())
+            self._done(task, e)
+         else:
+            self._done(task)
+
+   def run(self):
+      if self.workers == 1:
+         self._worker()
+      else:
+         threads = [threading.Thread(target=self._worker)
+                    for _ in range(self.workers)]
+         for thread in threads:
+            thread.daemon = True
+            thread.start()
+         for thread in threads:
+            thread.join()
+
+      if self.error is not None:
+         raise self.error
@@ -0,0 +1,125 @@
+import logging
+import os
+import socket
+import threading
+import time
+
+NETLINK_KOBJECT_UEVENT = 15
+UEVENT_KERNEL_GROUP = 1
+
+# attributes and some class links do not generate uevents, the waiters are
+# checked at least this often regardless of the netlink activity
+RECHECK_INTERVAL = 0.2
+POLL_INTERVAL = 0.05
+
+class UeventMonitor(object):
+   """Wakes up threads waiting for sysfs paths when the kernel emits uevents.
+
+   A single thread listens on the kobject uevent netlink socket and, on every
+   event, checks the paths that are currently waited on. Each waiter is woken
+   as soon as its path shows up instead of at the next polling tick. When the
+   netlink socket cannot be opened the waiters fall back to polling.
+   Listeners are called from the monitor thread with every parsed uevent.
+   """
+   def __init__(self):
+      self.lock = threading.Lock()
+      self.waiters = {}
+      self.listeners = []
+      self.thread = None
+      self.sock = None
+      self.pid = None
+
+   def _open(self):
+      try:
+         sock = socket.socket(socket.AF_NETLINK, socket.SOCK_DGRAM,
+                              NETLINK_KOBJECT_UEVENT)
+         sock.bind((0, UEVENT_KERNEL_GROUP))
+      except (AttributeError, socket.error) as e:
+         logging.debug('uevent monitor unavailable, polling instead: %s', e)
+         return None
+      return sock
+
+   def _start(self):
+      # the monitor thread does not survive a fork, start a new one in the child
+      if self.pid == os.getpid():
+         return self.sock is not None
+      self.pid = os.getpid()
+      self.waiters = {}
+      self.sock = self._open()
+      if self.sock is None:
+         return False
+      self.thread = threading.Thread(target=self._run)
+      self.thread.daemon = True
+      self.thread.start()
+      return True
+
+   def _run(self):
+      while True:
+         try:
+            data = self.sock.recv(8192)
+         except socket.error as e:
+            logging.debug('uevent monitor stopped: %s', e)
+            return
+         self._notify()
+         self._dispatch(parseUevent(data))
+
+   def _dispatch(self, event):
+      with self.lock:
+         listeners = list(self.listeners)
+      for listener in listeners:
+         try:
+            listener(event)
+         except Exception as e:
+            logging.error('uevent listener %s failed: %s', listener, e)
+
+   def addListener(self, listener):
+      """Returns False when no uevent will ever be delivered."""
+      with self.lock:
+         self.listeners.append(listener)
+         return self._start()
+
+   def _notify(self):
+      with self.lock:
+         for event, path in self.waiters.items():
+            if os.path.exists(path):
+               event.set()
+
+   def waitForPath(self, path, timeout):
+      if os.path.exists(path):
+         return True
+
+      event = threading.Event()
+      with self.lock:
+         interval = RECHECK_INTERVAL if self._start() else POLL_INTERVAL
+         self.waiters[event] = path
+
+      end = time.time() + timeout
+      try:
+         # check again now that the waiter is registered, the path could have
+         # appeared in between
+         while not os.path.exists(path):
+            remaining = end - time.time()
+            if remaining <= 0:
+               return False
+            event.wait(min(remaining, interval))
+         return True
+      finally:
+         with self.lock:
+            self.waiters.pop(event, None)
+
+def parseUevent(data):
+   # ACTION@DEVPATH followed by KEY=VALUE fields, all nul terminated
+   event = {}
+   for field in data.split(b'\0')[1:]:
+      key, sep, value = field.partition(b'=')
+      if sep:
+         event[key.decode()] = value.decode(errors='replace')
+   return event
+
+monitor = UeventMonitor()
+
+def waitForPath(path, timeout):
+   return monitor.waitForPath(path, timeout)
+
+def addUeventListener(listener):
+   return monitor.addListener(listener)
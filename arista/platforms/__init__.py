@@ -1,5 +1,25 @@
+"""
+Platform definitions
 
-import a7050qx32
-import a7050qx32s
-import a7060cx32s
-import a7260cx364
+The platform modules are only imported when needed, registry.py maps each SKU
+to the module defining it. The registry is generated by setup.py when the
+package is built, a platform missing from it is still found by importing all
+the modules as a last resort.
+"""
+
+import importlib
+import pkgutil
+
+from registry import platformModules
+
+def importPlatform(sku):
+   module = platformModules.get(sku)
+   if module is None:
+      return False
+   importlib.import_module('%s.%s' % (__name__, module))
+   return True
+
+def importAllPlatforms():
+   for _, module, _ in pkgutil.iter_modules(__path__):
+      if module != 'registry':
+         importlib.import_module('%s.%s' % (__name__, module))
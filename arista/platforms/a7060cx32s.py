@@ -6,6 +6,7 @@ from ..core.component import Priority
 
 from ..components.common import SwitchChip, I2cKernelComponent
 from ..components.scd import Scd
+from ..components.thermal import ThermalDriver, i2cSensor
 
 @registerPlatform(['DCS-7060CX-32S', 'DCS-7060CX-32S-ES'])
 class Upperlake(Platform):
@@ -18,11 +19,17 @@ class Upperlake(Platform):
       self.inventory.addPorts(sfps=self.sfpRange, qsfps=self.qsfp100gRange)
 
       self.addDriver(KernelDriver, 'crow-fan-driver')
+      # local temperatures of the max6697 and max6658 below
+      self.addDriver(ThermalDriver, [i2cSensor(I2cAddr(2, 0x1a), 0x07),
+                                     i2cSensor(I2cAddr(3, 0x4c), 0x00),
+                                     'acpitz', 'x86_pkg_temp'],
+                     [(35000, 102), (45000, 153), (55000, 204), (65000, 255)],
+                     minPwm=102)
 
       switchChip = SwitchChip(PciAddr(bus=0x01))
       self.addComponent(switchChip)
 
-      scd = Scd(PciAddr(bus=0x02), newDriver=True)
+      scd = Scd(PciAddr(bus=0x02), newDriver=True, mmapRW=True)
       self.addComponent(scd)
 
       scd.addComponents([
@@ -0,0 +1,11 @@
+# This file is generated by setup.py from the @registerPlatform decorators of
+# the platform modules, do not edit.
+
+platformModules = {
+   'DCS-7050QX-32': 'a7050qx32',
+   'DCS-7050QX-32S': 'a7050qx32s',
+   'DCS-7050QX2-32S': 'a7050qx32s',
+   'DCS-7060CX-32S': 'a7060cx32s',
+   'DCS-7060CX-32S-ES': 'a7060cx32s',
+   'DCS-7260CX3-64': 'a7260cx364',
+}
@@ -18,7 +18,7 @@ import StringIO
 import os
 
 from ..core import prefdl
-from ..core.platform import fmted_prefdl_path
+from ..core.platform import fmted_prefdl_path, prefdl_sysfs_path
 
 try:
    from sonic_eeprom import eeprom_base
@@ -34,6 +34,11 @@ class board(eeprom_tlvinfo.TlvInfoDecoder):
       super(board, self).__init__(self.prefdl_path, 0, '', True)
 
    def read_eeprom(self):
+      # prefer the fields already decoded by the kernel over the cached file
+      if os.path.exists(prefdl_sysfs_path):
+         pfdl = prefdl.PreFdlFromSysfs(prefdl_sysfs_path)
+         data = list(pfdl.data().items()) + [('Crc', pfdl.getCrc())]
+         return ''.join('%s: %s\n' % (k, v) for k, v in data)
       with open(self.prefdl_path) as fp:
          return fp.read()
 
@@ -1,8 +1,9 @@
+import logging
 import re
-from collections import namedtuple, defaultdict
+from collections import namedtuple
 
-from ..core import platform
-import arista.platforms
+from ..core.daemon import getInventory
+from ..core.ledbank import LedBank
 
 try:
    from sonic_led import led_control_base
@@ -54,7 +55,6 @@ def parsePortConfig(portConfigPath):
 
 class LedControl(led_control_base.LedControlBase):
    PORT_CONFIG_PATH = '/usr/share/sonic/hwsku/port_config.ini'
-   LED_SYSFS_PATH = '/sys/class/leds/{0}/brightness'
 
    LED_COLOR_OFF = 0
    LED_COLOR_GREEN = 1
@@ -62,17 +62,52 @@ class LedControl(led_control_base.LedControlBase):
 
    def __init__(self):
       self.portMapping = parsePortConfig(self.PORT_CONFIG_PATH)
-      self.portSysfsMapping = defaultdict(list)
-
-      inventory = platform.getPlatform().getInventory()
-      for port, names in inventory.xcvrLeds.items():
-         for name in names:
-            self.portSysfsMapping[port].append(self.LED_SYSFS_PATH.format(name))
+      self.inventory = getInventory()
+      # last color written to each led, only the changes are sent
+      self.ledState = {}
 
       # Set status leds to green initially (Rook led driver does this automatically)
-      for statusLed in inventory.statusLeds:
-         with open(self.LED_SYSFS_PATH.format(statusLed), 'w') as fp:
-            fp.write('%d' % self.LED_COLOR_GREEN)
+      self.setLeds({ name : self.LED_COLOR_GREEN
+                     for name in self.inventory.statusLeds })
+
+      # ports whose leds follow the link state in the kernel are not updated here
+      self.kernelPorts = self.bindPortLeds()
+
+   def portLedColors(self, p, up):
+      '''Returns the color of each led of a port for a given link state'''
+      leds = {}
+      for idx in range(p.lanes):
+         name = self.inventory.xcvrLeds[p.portNum][p.offset + idx]
+         if not up:
+            leds[name] = self.LED_COLOR_OFF
+         elif idx == 0:
+            leds[name] = self.LED_COLOR_GREEN
+         else:
+            leds[name] = self.LED_COLOR_YELLOW
+         if p.singular:
+            break
+      return leds
+
+   def bindPortLeds(self):
+      bindings = {}
+      for port, p in self.portMapping.items():
+         for name, color in self.portLedColors(p, True).items():
+            bindings[name] = (port, color)
+      try:
+         bound = LedBank().bindNetdevs(bindings)
+      except (IOError, OSError) as e:
+         logging.warning('failed to bind the port leds to netdevs: %s', e)
+         return set()
+      return set(port for port, p in self.portMapping.items()
+                 if set(self.portLedColors(p, True)) <= bound)
+
+   def setLeds(self, leds):
+      changed = { name : value for name, value in leds.items()
+                  if self.ledState.get(name) != value }
+      if not changed:
+         return
+      self.inventory.setLeds(changed)
+      self.ledState.update(changed)
 
    def port_link_state_change(self, port, state):
       '''
@@ -80,20 +115,12 @@ class LedControl(led_control_base.LedControlBase):
       many subsequent LEDs should be affected (hardcoded by the port_config)
       '''
       p = self.portMapping.get(port)
-      if not p:
+      if not p or port in self.kernelPorts:
          return
-      for idx in range(p.lanes):
-         path = self.portSysfsMapping[p.portNum][p.offset + idx]
-         with open(path, 'w') as fp:
-            if state == 'up':
-               if idx == 0:
-                  fp.write('%d' % self.LED_COLOR_GREEN)
-               else:
-                  fp.write('%d' % self.LED_COLOR_YELLOW)
-            elif state == 'down':
-               fp.write('%d' % self.LED_COLOR_OFF)
-         if p.singular:
-            return
+      if state not in ('up', 'down'):
+         return
+      # all the leds of the port are updated at once
+      self.setLeds(self.portLedColors(p, state == 'up'))
 
 def getLedControl():
    return LedControl
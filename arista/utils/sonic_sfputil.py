@@ -1,7 +1,6 @@
 import time
 
-from ..core import platform as core_platform
-from .. import platforms
+from ..core.daemon import getInventory
 
 try:
     from sonic_sfp.sfputilbase import SfpUtilBase
@@ -10,8 +9,7 @@ except ImportError as e:
 
 
 def getSfpUtil():
-    platform = core_platform.getPlatform()
-    inventory = platform.getInventory()
+    inventory = getInventory()
 
     class SfpUtil(SfpUtilBase):
         """Platform-specific SfpUtil class"""
@@ -0,0 +1,169 @@
+/* Copyright (c) 2026 Arista Networks, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "libscd.h"
+
+int scd_open(struct scd_handle *scd, const char *devpath)
+{
+   char path[256];
+   struct stat st;
+   void *mem;
+   int fd;
+   int err;
+
+   memset(scd, 0, sizeof(*scd));
+
+   snprintf(path, sizeof(path), "%s/resource0", devpath);
+   fd = open(path, O_RDWR | O_SYNC);
+   if (fd < 0) {
+      return -errno;
+   }
+
+   if (fstat(fd, &st) < 0) {
+      err = -errno;
+      close(fd);
+      return err;
+   }
+
+   mem = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   err = -errno;
+   close(fd);
+   if (mem == MAP_FAILED) {
+      return err;
+   }
+
+   scd->mem = mem;
+   scd->size = st.st_size;
+
+   return 0;
+}
+
+void scd_close(struct scd_handle *scd)
+{
+   if (scd->mem) {
+      munmap((void *)scd->mem, scd->size);
+      scd->mem = NULL;
+      scd->size = 0;
+   }
+}
+
+int scd_gpio_get(const struct scd_handle *scd, uint32_t addr, unsigned int bit,
+                 int active_low)
+{
+   int res = !!(scd_read32(scd, addr) & (1 << bit));
+   return active_low ? !res : res;
+}
+
+int scd_gpio_set(const struct scd_handle *scd, uint32_t addr, unsigned int bit,
+                 int active_low, int value)
+{
+   uint32_t reg;
+
+   if (value != 0 && value != 1) {
+      return -EINVAL;
+   }
+
+   reg = scd_read32(scd, addr);
+   if (value != !!active_low) {
+      reg |= 1 << bit;
+   } else {
+      reg &= ~(1 << bit);
+   }
+   scd_write32(scd, addr, reg);
+
+   return 0;
+}
+
+uint32_t scd_gpio_get_mask(const struct scd_handle *scd, uint32_t addr,
+                           uint32_t mask, uint32_t active_low_mask)
+{
+   return (scd_read32(scd, addr) ^ active_low_mask) & mask;
+}
+
+int scd_reset_get(const struct scd_handle *scd, uint32_t addr, unsigned int bit)
+{
+   return !!(scd_read32(scd, addr) & (1 << bit));
+}
+
+void scd_reset_set(const struct scd_handle *scd, uint32_t addr, unsigned int bit,
+                   int value)
+{
+   uint32_t offset = value ? SCD_RESET_SET_OFFSET : SCD_RESET_CLEAR_OFFSET;
+   scd_write32(scd, addr + offset, 1 << bit);
+}
+
+// keep in sync with led_brightness_set in src/scd-hwmon.c
+static const uint32_t led_brightness_regs[] = {
+   0x0006ff00,
+   0x1006ff00,
+   0x0806ff00,
+   0x1806ff00,
+   0x1406ff00,
+   0x0C06ff00,
+   0x1C06ff00,
+};
+
+void scd_led_set(const struct scd_handle *scd, uint32_t addr, unsigned int brightness)
+{
+   uint32_t reg = 0x1806ff00;
+
+   if (brightness < sizeof(led_brightness_regs) / sizeof(led_brightness_regs[0])) {
+      reg = led_brightness_regs[brightness];
+   }
+   scd_write32(scd, addr, reg);
+}
+
+uint32_t scd_led_get(const struct scd_handle *scd, uint32_t addr)
+{
+   return scd_read32(scd, addr);
+}
+
+void scd_smbus_write_request(const struct scd_handle *scd, uint32_t master,
+                             union scd_smbus_request req)
+{
+   scd_write32(scd, master + SCD_SMBUS_REQUEST_OFFSET, req.reg);
+}
+
+union scd_smbus_ctrl_status scd_smbus_read_ctrl_status(const struct scd_handle *scd,
+                                                       uint32_t master)
+{
+   union scd_smbus_ctrl_status cs;
+   cs.reg = scd_read32(scd, master + SCD_SMBUS_CONTROL_STATUS_OFFSET);
+   return cs;
+}
+
+void scd_smbus_write_ctrl_status(const struct scd_handle *scd, uint32_t master,
+                                 union scd_smbus_ctrl_status cs)
+{
+   scd_write32(scd, master + SCD_SMBUS_CONTROL_STATUS_OFFSET, cs.reg);
+}
+
+union scd_smbus_response scd_smbus_read_response(const struct scd_handle *scd,
+                                                 uint32_t master)
+{
+   union scd_smbus_response resp;
+   resp.reg = scd_read32(scd, master + SCD_SMBUS_RESPONSE_OFFSET);
+   return resp;
+}
@@ -0,0 +1,144 @@
+/* Copyright (c) 2026 Arista Networks, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Userspace access to the scd registers.
+ *
+ * The library maps the resource0 file of the scd pci device and gives typed
+ * accessors to the gpio, reset, led and smbus master registers handled by the
+ * scd-hwmon driver.  The register layout is the same as the one given to the
+ * driver by arista/components/scd.py.  Once the mapping is done no syscall is
+ * involved.
+ *
+ * Note that the read-modify-write of the gpio registers is not atomic with
+ * respect to the kernel driver or other processes.
+ */
+
+#ifndef _LIBSCD_H_
+#define _LIBSCD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct scd_handle {
+   volatile uint8_t *mem;
+   size_t size;
+};
+
+#define SCD_RESET_SET_OFFSET 0x00
+#define SCD_RESET_CLEAR_OFFSET 0x10
+
+#define SCD_SMBUS_REQUEST_OFFSET 0x10
+#define SCD_SMBUS_CONTROL_STATUS_OFFSET 0x20
+#define SCD_SMBUS_RESPONSE_OFFSET 0x30
+
+// same encoding as request_reg in src/scd-hwmon.c
+union scd_smbus_request {
+   uint32_t reg;
+   struct {
+      uint32_t d:8;
+      uint32_t ss:6;
+      uint32_t reserved1:2;
+      uint32_t dat:2;
+      uint32_t t:2;
+      uint32_t sp:1;
+      uint32_t da:1;
+      uint32_t dod:1;
+      uint32_t st:1;
+      uint32_t bs:4;
+      uint32_t ti:4;
+   } __attribute__((packed));
+};
+
+// same encoding as ctrl_status_reg in src/scd-hwmon.c
+union scd_smbus_ctrl_status {
+   uint32_t reg;
+   struct {
+      uint32_t reserved1:13;
+      uint32_t foe:1;
+      uint32_t reserved2:17;
+      uint32_t reset:1;
+   } __attribute__((packed));
+};
+
+// same encoding as response_reg in src/scd-hwmon.c
+union scd_smbus_response {
+   uint32_t reg;
+   struct {
+      uint32_t d:8;
+      uint32_t bus_conflict_error:1;
+      uint32_t timeout_error:1;
+      uint32_t ack_error:1;
+      uint32_t flushed:1;
+      uint32_t ti:4;
+      uint32_t ss:6;
+      uint32_t reserved2:9;
+      uint32_t fe:1;
+   } __attribute__((packed));
+};
+
+// devpath is the sysfs directory of the pci device, e.g /sys/bus/pci/devices/0000:02:00.0
+int scd_open(struct scd_handle *scd, const char *devpath);
+void scd_close(struct scd_handle *scd);
+
+static inline uint32_t scd_read32(const struct scd_handle *scd, uint32_t offset)
+{
+   return *(volatile uint32_t *)(scd->mem + offset);
+}
+
+static inline void scd_write32(const struct scd_handle *scd, uint32_t offset,
+                               uint32_t value)
+{
+   *(volatile uint32_t *)(scd->mem + offset) = value;
+}
+
+int scd_gpio_get(const struct scd_handle *scd, uint32_t addr, unsigned int bit,
+                 int active_low);
+int scd_gpio_set(const struct scd_handle *scd, uint32_t addr, unsigned int bit,
+                 int active_low, int value);
+// read all the gpios of mask from the same register in one access, active low
+// gpios are inverted
+uint32_t scd_gpio_get_mask(const struct scd_handle *scd, uint32_t addr,
+                           uint32_t mask, uint32_t active_low_mask);
+
+int scd_reset_get(const struct scd_handle *scd, uint32_t addr, unsigned int bit);
+void scd_reset_set(const struct scd_handle *scd, uint32_t addr, unsigned int bit,
+                   int value);
+
+// brightness as understood by the scd-hwmon led class devices
+void scd_led_set(const struct scd_handle *scd, uint32_t addr, unsigned int brightness);
+uint32_t scd_led_get(const struct scd_handle *scd, uint32_t addr);
+
+// master is the base address of an smbus master, as given to addSmbusMaster
+void scd_smbus_write_request(const struct scd_handle *scd, uint32_t master,
+                             union scd_smbus_request req);
+union scd_smbus_ctrl_status scd_smbus_read_ctrl_status(const struct scd_handle *scd,
+                                                       uint32_t master);
+void scd_smbus_write_ctrl_status(const struct scd_handle *scd, uint32_t master,
+                                 union scd_smbus_ctrl_status cs);
+union scd_smbus_response scd_smbus_read_response(const struct scd_handle *scd,
+                                                 uint32_t master);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIBSCD_H_ */
@@ -0,0 +1,146 @@
+/* Copyright (c) 2026 Arista Networks, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Header only helper to read the scd ptp time counter from userspace.
+ *
+ * The ptp registers can't be read from userspace: reading the high register
+ * latches the low one and the kernel readers would race with us.  Instead the
+ * scd driver samples the counter with CLOCK_MONOTONIC every ptp_page_interval_ms
+ * into a page exposed read only through the ptp_time attribute of the pci
+ * device.  The time is extrapolated from the last sample, which only costs a
+ * vdso clock_gettime.  The error is the drift between the two clocks over one
+ * interval, in the order of a microsecond for the default of 10ms.  The driver
+ * only samples while the page is mapped somewhere, keep it mapped rather than
+ * mapping it for every read.
+ *
+ *    struct scd_ptp ptp;
+ *    uint64_t now;
+ *    if (!scd_ptp_open(&ptp, "/sys/bus/pci/devices/0000:02:00.0")) {
+ *       if (!scd_ptp_read(&ptp, &now)) {
+ *          ...
+ *       }
+ *       scd_ptp_close(&ptp);
+ *    }
+ */
+
+#ifndef _SCD_PTP_H_
+#define _SCD_PTP_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+// must match struct scd_ptp_page in src/scd.h
+#define SCD_PTP_PAGE_VERSION 1
+
+struct scd_ptp_page {
+   uint32_t seq;
+   uint32_t version;
+   uint64_t ptp_ns;
+   uint64_t monotonic_ns;
+   uint64_t interval_ns;
+} __attribute__((packed));
+
+// a sample older than this many intervals means the driver stopped updating it
+#define SCD_PTP_STALE_INTERVALS 10
+
+struct scd_ptp {
+   void *page;
+   size_t page_size;
+   const volatile struct scd_ptp_page *sample;
+};
+
+static inline int scd_ptp_open(struct scd_ptp *ptp, const char *devpath)
+{
+   char path[256];
+   void *page;
+   int fd;
+
+   snprintf(path, sizeof(path), "%s/ptp_time", devpath);
+   fd = open(path, O_RDONLY);
+   if (fd < 0) {
+      return -errno;
+   }
+
+   ptp->page_size = sysconf(_SC_PAGESIZE);
+   page = mmap(NULL, ptp->page_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (page == MAP_FAILED) {
+      return -errno;
+   }
+
+   ptp->page = page;
+   ptp->sample = (const volatile struct scd_ptp_page *)page;
+   if (ptp->sample->version != SCD_PTP_PAGE_VERSION) {
+      munmap(page, ptp->page_size);
+      ptp->page = NULL;
+      return -EPROTO;
+   }
+
+   return 0;
+}
+
+/*
+ * The kernel makes seq odd while it updates the sample, retry if it was odd or
+ * moved while the sample was copied.
+ */
+static inline int scd_ptp_read(const struct scd_ptp *ptp, uint64_t *ns)
+{
+   const volatile struct scd_ptp_page *sample = ptp->sample;
+   uint64_t ptp_ns, monotonic_ns, interval_ns, now_ns;
+   struct timespec now;
+   uint32_t seq;
+
+   do {
+      seq = sample->seq;
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      ptp_ns = sample->ptp_ns;
+      monotonic_ns = sample->monotonic_ns;
+      interval_ns = sample->interval_ns;
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   } while ((seq & 1) || seq != sample->seq);
+
+   if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+      return -errno;
+   }
+   now_ns = (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+
+   if (now_ns < monotonic_ns) {
+      now_ns = monotonic_ns;
+   }
+   if (now_ns - monotonic_ns > SCD_PTP_STALE_INTERVALS * interval_ns) {
+      return -ESTALE;
+   }
+
+   *ns = ptp_ns + (now_ns - monotonic_ns);
+   return 0;
+}
+
+static inline void scd_ptp_close(struct scd_ptp *ptp)
+{
+   if (ptp->page) {
+      munmap(ptp->page, ptp->page_size);
+      ptp->page = NULL;
+   }
+}
+
+#endif /* _SCD_PTP_H_ */
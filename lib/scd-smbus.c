@@ -0,0 +1,306 @@
+/* Copyright (c) 2026 Arista Networks, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "scd-smbus.h"
+
+#define SMBUS_MAX_RETRIES 3
+// same overall budget as the 10 x 10ms of the kernel driver
+#define SMBUS_RESPONSE_TIMEOUT_NS (100 * 1000 * 1000ULL)
+#define SMBUS_RESET_DELAY_US 10000
+
+const struct scd_smbus_params scd_smbus_default_params = {
+   .t = 1,
+   .datw = 3,
+   .datr = 3,
+};
+
+static int scd_smbus_set_owner(const char *devpath, uint32_t master_id,
+                               const char *owner)
+{
+   char path[256];
+   char line[32];
+   int len;
+   int fd;
+   int rc = 0;
+
+   snprintf(path, sizeof(path), "%s/smbus_master_owner", devpath);
+   fd = open(path, O_WRONLY);
+   if (fd < 0) {
+      return -errno;
+   }
+
+   len = snprintf(line, sizeof(line), "%u %s", master_id, owner);
+   if (write(fd, line, len) != len) {
+      rc = -errno;
+   }
+   close(fd);
+
+   return rc;
+}
+
+int scd_smbus_acquire(const char *devpath, uint32_t master_id)
+{
+   return scd_smbus_set_owner(devpath, master_id, "user");
+}
+
+int scd_smbus_release(const char *devpath, uint32_t master_id)
+{
+   return scd_smbus_set_owner(devpath, master_id, "kernel");
+}
+
+void scd_smbus_reset(const struct scd_handle *scd, uint32_t master)
+{
+   union scd_smbus_ctrl_status cs;
+
+   cs = scd_smbus_read_ctrl_status(scd, master);
+   cs.reset = 1;
+   cs.foe = 1;
+   scd_smbus_write_ctrl_status(scd, master, cs);
+   usleep(SMBUS_RESET_DELAY_US);
+   cs.reset = 0;
+   scd_smbus_write_ctrl_status(scd, master, cs);
+}
+
+static uint64_t scd_smbus_now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static union scd_smbus_response scd_smbus_wait_response(const struct scd_handle *scd,
+                                                        uint32_t master)
+{
+   union scd_smbus_response resp;
+   uint64_t deadline = 0;
+
+   resp = scd_smbus_read_response(scd, master);
+   while (resp.fe) {
+      if (!deadline) {
+         deadline = scd_smbus_now_ns() + SMBUS_RESPONSE_TIMEOUT_NS;
+      } else if (scd_smbus_now_ns() > deadline) {
+         resp.reg = 0xffffffff;
+         break;
+      }
+      resp = scd_smbus_read_response(scd, master);
+   }
+
+   return resp;
+}
+
+// keep in sync with smbus_check_resp in src/scd-hwmon.c
+static int scd_smbus_check_response(union scd_smbus_response resp, uint32_t tid)
+{
+   if (resp.reg == 0xffffffff) {
+      return -EAGAIN;
+   }
+   if (resp.ack_error || resp.timeout_error || resp.bus_conflict_error ||
+       resp.flushed) {
+      return -EIO;
+   }
+   if (resp.ti != tid) {
+      return -EAGAIN;
+   }
+   return 0;
+}
+
+// keep in sync with scd_smbus_do in src/scd-hwmon.c
+static int scd_smbus_do(const struct scd_handle *scd, uint32_t master, uint8_t bus,
+                        uint16_t addr, char read_write, uint8_t command, int size,
+                        union i2c_smbus_data *data,
+                        const struct scd_smbus_params *params)
+{
+   union scd_smbus_request req;
+   union scd_smbus_response resp;
+   uint32_t data_offset = 0;
+   uint32_t ss = 0;
+   uint32_t i;
+   int ret;
+
+   req.reg = 0;
+   req.bs = bus;
+   req.t = params->t;
+
+   switch (size) {
+   case I2C_SMBUS_QUICK:
+      ss = 1;
+      break;
+   case I2C_SMBUS_BYTE:
+      ss = 2;
+      break;
+   case I2C_SMBUS_BYTE_DATA:
+      ss = (read_write == I2C_SMBUS_WRITE) ? 3 : 4;
+      break;
+   case I2C_SMBUS_WORD_DATA:
+      ss = (read_write == I2C_SMBUS_WRITE) ? 4 : 5;
+      break;
+   case I2C_SMBUS_I2C_BLOCK_DATA:
+      if (data->block[0] > I2C_SMBUS_BLOCK_MAX) {
+         return -EINVAL;
+      }
+      data_offset = 1;
+      if (read_write == I2C_SMBUS_WRITE) {
+         ss = 2 + data->block[0];
+      } else {
+         ss = 3 + data->block[0];
+      }
+      break;
+   case I2C_SMBUS_BLOCK_DATA:
+      if (read_write == I2C_SMBUS_WRITE) {
+         if (data->block[0] > I2C_SMBUS_BLOCK_MAX) {
+            return -EINVAL;
+         }
+         ss = 3 + data->block[0];
+      } else {
+         ret = scd_smbus_do(scd, master, bus, addr, I2C_SMBUS_READ, command,
+                            I2C_SMBUS_BYTE_DATA, data, params);
+         if (ret) {
+            return ret;
+         }
+         // the length comes from the device
+         if (data->block[0] > I2C_SMBUS_BLOCK_MAX) {
+            scd_smbus_reset(scd, master);
+            return -EPROTO;
+         }
+         ss = 4 + data->block[0];
+      }
+      break;
+   default:
+      return -EINVAL;
+   }
+
+   req.st = 1;
+   req.ss = ss;
+   req.d = (((addr & 0xff) << 1) | ((ss <= 2) ? read_write : 0));
+   req.dod = 1;
+   for (i = 0; i < ss; i++) {
+      if (i == ss - 1) {
+         req.sp = 1;
+         if (read_write == I2C_SMBUS_WRITE) {
+            req.dat = params->datw;
+         } else {
+            req.dat = params->datr;
+         }
+      }
+      if (i == 1) {
+         req.st = 0;
+         req.ss = 0;
+         req.d = command;
+         if (ss == 2)
+            req.dod = ((read_write == I2C_SMBUS_WRITE) ? 1 : 0);
+         else
+            req.dod = 1;
+      }
+      if ((i == 2 && read_write == I2C_SMBUS_READ)) {
+         req.st = 1;
+         req.d = (((addr & 0xff) << 1) | 1);
+      }
+      if (i >= 2 && (read_write == I2C_SMBUS_WRITE)) {
+         req.d = data->block[data_offset + i - 2];
+      }
+      if ((i == 3 && read_write == I2C_SMBUS_READ)) {
+         req.dod = 0;
+      }
+      req.da = ((!(req.dod || req.sp)) ? 1 : 0);
+      scd_smbus_write_request(scd, master, req);
+      req.ti++;
+      req.st = 0;
+   }
+
+   req.ti = 0;
+   for (i = 0; i < ss; i++) {
+      resp = scd_smbus_wait_response(scd, master);
+      ret = scd_smbus_check_response(resp, req.ti);
+      if (ret) {
+         scd_smbus_reset(scd, master);
+         return ret;
+      }
+      req.ti++;
+      if (read_write == I2C_SMBUS_READ) {
+         if (size == I2C_SMBUS_BYTE || size == I2C_SMBUS_BYTE_DATA) {
+            if (i == ss - 1) {
+               data->byte = resp.d;
+            }
+         } else if (size == I2C_SMBUS_WORD_DATA) {
+            if (i == ss - 2) {
+               data->word = resp.d;
+            } else if (i == ss - 1) {
+               data->word |= (resp.d << 8);
+            }
+         } else {
+            if (i >= 3) {
+               if (size == I2C_SMBUS_BLOCK_DATA) {
+                  data->block[i - 3] = resp.d;
+               } else {
+                  data->block[i - 2] = resp.d;
+               }
+            }
+         }
+      }
+   }
+
+   return 0;
+}
+
+int scd_smbus_xfer(const struct scd_handle *scd, uint32_t master, uint8_t bus,
+                   uint16_t addr, char read_write, uint8_t command, int size,
+                   union i2c_smbus_data *data,
+                   const struct scd_smbus_params *params)
+{
+   int retry = 0;
+   int ret;
+
+   if (!params) {
+      params = &scd_smbus_default_params;
+   }
+
+   do {
+      ret = scd_smbus_do(scd, master, bus, addr, read_write, command, size, data,
+                         params);
+      if (ret != -EAGAIN) {
+         return ret;
+      }
+   } while (++retry < SMBUS_MAX_RETRIES);
+
+   return -EIO;
+}
+
+int scd_smbus_batch(const struct scd_handle *scd, uint32_t master,
+                    struct scd_smbus_op *ops, size_t count,
+                    const struct scd_smbus_params *params)
+{
+   int failed = 0;
+   size_t i;
+
+   for (i = 0; i < count; i++) {
+      ops[i].result = scd_smbus_xfer(scd, master, ops[i].bus, ops[i].addr,
+                                     ops[i].read_write, ops[i].command,
+                                     ops[i].size, &ops[i].data, params);
+      if (ops[i].result) {
+         failed++;
+      }
+   }
+
+   return failed;
+}
@@ -0,0 +1,88 @@
+/* Copyright (c) 2026 Arista Networks, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Userspace SMBus engine for the scd smbus masters.
+ *
+ * This is the same request/response protocol as scd_smbus_do in
+ * src/scd-hwmon.c, run on the mapped resource0.  The response fifo is busy
+ * polled instead of sleeping between reads.
+ *
+ * The kernel driver must be told to keep away from a master before it is driven
+ * from userspace, see scd_smbus_acquire().  While a master is owned by userspace,
+ * the i2c adapters of its buses fail every transaction with -EBUSY.  The master
+ * belongs to the process calling scd_smbus_acquire(), the kernel takes it back
+ * when that process exits.
+ */
+
+#ifndef _SCD_SMBUS_H_
+#define _SCD_SMBUS_H_
+
+#include <linux/i2c.h>
+
+#include "libscd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// per device timing parameters, same meaning as the smbus_tweaks of scd-hwmon
+struct scd_smbus_params {
+   uint8_t t;
+   uint8_t datw;
+   uint8_t datr;
+};
+
+extern const struct scd_smbus_params scd_smbus_default_params;
+
+struct scd_smbus_op {
+   uint8_t bus;
+   uint16_t addr;
+   char read_write;
+   uint8_t command;
+   int size;
+   union i2c_smbus_data data;
+   int result;
+};
+
+// take master_id away from the kernel driver, devpath is the pci device directory
+int scd_smbus_acquire(const char *devpath, uint32_t master_id);
+// give it back, the kernel resets the master
+int scd_smbus_release(const char *devpath, uint32_t master_id);
+
+void scd_smbus_reset(const struct scd_handle *scd, uint32_t master);
+
+/*
+ * Run one transaction, read_write and size take the I2C_SMBUS_* values.
+ * master is the base address of the master.  params may be NULL.
+ * Returns 0 or a negative errno.
+ */
+int scd_smbus_xfer(const struct scd_handle *scd, uint32_t master, uint8_t bus,
+                   uint16_t addr, char read_write, uint8_t command, int size,
+                   union i2c_smbus_data *data,
+                   const struct scd_smbus_params *params);
+
+// run count transactions back to back, returns the number of failed ones
+int scd_smbus_batch(const struct scd_handle *scd, uint32_t master,
+                    struct scd_smbus_op *ops, size_t count,
+                    const struct scd_smbus_params *params);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SCD_SMBUS_H_ */
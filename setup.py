@@ -1,6 +1,53 @@
 #!/usr/bin/env python
 
+import ast
+import os
+
 from setuptools import setup
+from setuptools.command.build_py import build_py
+
+PLATFORMS_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                             'arista', 'platforms')
+
+REGISTRY_HEADER = """\
+# This file is generated by setup.py from the @registerPlatform decorators of
+# the platform modules, do not edit.
+
+"""
+
+def findPlatformSkus(path):
+   with open(path) as f:
+      tree = ast.parse(f.read(), path)
+   skus = []
+   for node in ast.walk(tree):
+      if not isinstance(node, ast.ClassDef):
+         continue
+      for decorator in node.decorator_list:
+         if isinstance(decorator, ast.Call) and \
+            getattr(decorator.func, 'id', None) == 'registerPlatform':
+            value = ast.literal_eval(decorator.args[0])
+            skus += value if isinstance(value, list) else [value]
+   return skus
+
+def generatePlatformRegistry():
+   registry = {}
+   for filename in sorted(os.listdir(PLATFORMS_DIR)):
+      module, ext = os.path.splitext(filename)
+      if ext != '.py' or module in ['__init__', 'registry']:
+         continue
+      for sku in findPlatformSkus(os.path.join(PLATFORMS_DIR, filename)):
+         registry[sku] = module
+
+   lines = ['platformModules = {']
+   lines += ["   '%s': '%s'," % (sku, registry[sku]) for sku in sorted(registry)]
+   lines += ['}']
+   with open(os.path.join(PLATFORMS_DIR, 'registry.py'), 'w') as f:
+      f.write(REGISTRY_HEADER + '\n'.join(lines) + '\n')
+
+class BuildPy(build_py):
+   def run(self):
+      generatePlatformRegistry()
+      build_py.run(self)
 
 setup(
    name='arista',
@@ -13,5 +60,8 @@ setup(
       'arista.platforms',
       'arista.utils',
    ],
+   cmdclass={
+      'build_py': BuildPy,
+   },
 )
 
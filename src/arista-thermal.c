@@ -0,0 +1,813 @@
+/* Copyright (c) 2026 Arista Networks, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Closed loop fan control.  The hottest of the configured sensors is turned
+ * into a pwm, either through a table or a PID controller, and applied to every
+ * arista-fan cooling device at a fixed interval.  Userspace only writes the
+ * policy in the sysfs attributes of the arista-thermal device.
+ *
+ *   sensors      thermal zone types or <i2c device>:<register> in hex, like
+ *                2-001a:07, separated by spaces or new lines
+ *   mode         off, table or pid
+ *   table        <temp>:<pwm> points with increasing temperatures, the pwm is
+ *                interpolated between them
+ *   pid          <setpoint> <kp> <ki> <kd>, gains in pwm per degree, per degree
+ *                second and per degree per second, added to min_pwm
+ *   min_pwm      lowest pwm ever applied
+ *   interval_ms  interval between two iterations of the loop
+ *
+ * Temperatures are in millidegrees.  When none of the sensors can be read the
+ * fans are set to full speed.
+ *
+ * The board sensors are driven by the standard hwmon drivers and are not
+ * thermal zones on these platforms.  They are read through the i2c device the
+ * platform created for them, the register must hold the temperature in degrees
+ * as a signed byte, which is the case of the lm73, lm90 and max6697 families.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/i2c.h>
+#include <linux/platform_device.h>
+#include <linux/thermal.h>
+#include <linux/workqueue.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/version.h>
+
+#include "arista-thermal.h"
+
+#define DRIVER_NAME "arista-thermal"
+
+#define MAX_SENSORS 16
+#define MAX_COOLING_DEVICES 8
+#define MAX_TABLE_POINTS 16
+
+#define MIN_INTERVAL_MS 50
+
+static unsigned long interval_ms = 200;
+module_param(interval_ms, ulong, S_IRUSR);
+MODULE_PARM_DESC(interval_ms, "default interval between two iterations in ms");
+
+enum thermal_mode {
+   THERMAL_MODE_OFF = 0,
+   THERMAL_MODE_TABLE,
+   THERMAL_MODE_PID,
+};
+
+static const char *const thermal_mode_names[] = {
+   [THERMAL_MODE_OFF] = "off",
+   [THERMAL_MODE_TABLE] = "table",
+   [THERMAL_MODE_PID] = "pid",
+};
+
+struct thermal_sensor {
+   // zone type or i2c device name
+   char name[THERMAL_NAME_LENGTH];
+   bool i2c;
+   u8 reg;
+};
+
+struct thermal_point {
+   int temp;
+   u8 pwm;
+};
+
+struct thermal_pid {
+   int setpoint;
+   int kp;
+   int ki;
+   int kd;
+
+   s64 integral;
+   int prev_error;
+   bool primed;
+};
+
+struct thermal_data {
+   struct platform_device *pdev;
+   struct thermal_zone_device *tz;
+   struct mutex lock;
+   struct delayed_work dwork;
+
+   struct thermal_sensor sensors[MAX_SENSORS];
+   int sensor_count;
+
+   struct thermal_cooling_device *cdevs[MAX_COOLING_DEVICES];
+   int cdev_count;
+
+   enum thermal_mode mode;
+   struct thermal_point table[MAX_TABLE_POINTS];
+   int table_len;
+   struct thermal_pid pid;
+
+   unsigned long interval_ms;
+   u8 min_pwm;
+
+   bool temp_valid;
+   int temp;
+   u8 pwm;
+};
+
+static struct platform_device *thermal_pdev = NULL;
+static struct workqueue_struct *thermal_workqueue;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 3, 0)
+static int sensor_zone_temp(struct thermal_zone_device *tz, int *temp)
+{
+   return thermal_zone_get_temp(tz, temp);
+}
+#else
+static int sensor_zone_temp(struct thermal_zone_device *tz, int *temp)
+{
+   unsigned long val;
+   int err;
+
+   err = thermal_zone_get_temp(tz, &val);
+   if (!err)
+      *temp = val;
+   return err;
+}
+#endif
+
+// the reference on the client holds off the removal of its adapter
+static int sensor_i2c_temp(const struct thermal_sensor *sensor, int *temp)
+{
+   struct i2c_client *client;
+   struct device *dev;
+   s32 val = -ENODEV;
+
+   dev = bus_find_device_by_name(&i2c_bus_type, NULL, sensor->name);
+   if (!dev)
+      return -ENODEV;
+
+   client = i2c_verify_client(dev);
+   if (client)
+      val = i2c_smbus_read_byte_data(client, sensor->reg);
+   put_device(dev);
+
+   if (val < 0)
+      return val;
+
+   *temp = (s8)val * 1000;
+   return 0;
+}
+
+// zones can't be pinned, look the zone up again every time it is read
+static int sensor_read(const struct thermal_sensor *sensor, int *temp)
+{
+   struct thermal_zone_device *tz;
+
+   if (sensor->i2c)
+      return sensor_i2c_temp(sensor, temp);
+
+   tz = thermal_zone_get_zone_by_name(sensor->name);
+   if (IS_ERR(tz))
+      return PTR_ERR(tz);
+
+   return sensor_zone_temp(tz, temp);
+}
+
+static int thermal_read_temp(struct thermal_data *data,
+                             const struct thermal_sensor *sensors, int count,
+                             int *temp)
+{
+   int sensor_temp;
+   bool found = false;
+   int err;
+   int i;
+
+   for (i = 0; i < count; i++) {
+      err = sensor_read(&sensors[i], &sensor_temp);
+      if (err) {
+         dev_dbg(&data->pdev->dev, "failed to read %s error=%d\n",
+                 sensors[i].name, err);
+         continue;
+      }
+      if (!found || sensor_temp > *temp)
+         *temp = sensor_temp;
+      found = true;
+   }
+
+   return found ? 0 : -ENODATA;
+}
+
+// linear between the points of the table, flat outside of it
+static int thermal_table_pwm(struct thermal_data *data, int temp)
+{
+   const struct thermal_point *lo;
+   const struct thermal_point *hi;
+   int i;
+
+   if (!data->table_len)
+      return ARISTA_FAN_COOLING_MAX_STATE;
+
+   if (temp <= data->table[0].temp)
+      return data->table[0].pwm;
+
+   for (i = 1; i < data->table_len; i++) {
+      hi = &data->table[i];
+      if (temp > hi->temp)
+         continue;
+      lo = &data->table[i - 1];
+      return lo->pwm + ((int)hi->pwm - lo->pwm) * (temp - lo->temp) /
+                       (hi->temp - lo->temp);
+   }
+
+   return data->table[data->table_len - 1].pwm;
+}
+
+static int thermal_pid_pwm(struct thermal_data *data, int temp)
+{
+   struct thermal_pid *pid = &data->pid;
+   int error = temp - pid->setpoint;
+   s64 integral;
+   s64 deriv = 0;
+   s64 out;
+
+   if (pid->primed)
+      deriv = div_s64((s64)(error - pid->prev_error) * 1000, data->interval_ms);
+   pid->prev_error = error;
+   pid->primed = true;
+
+   integral = pid->integral + div_s64((s64)error * data->interval_ms, 1000);
+   out = (s64)pid->kp * error + (s64)pid->ki * integral + (s64)pid->kd * deriv;
+   out = div_s64(out, 1000) + data->min_pwm;
+
+   // stop integrating while the output is saturated to avoid windup
+   if (out >= data->min_pwm && out <= ARISTA_FAN_COOLING_MAX_STATE)
+      pid->integral = integral;
+
+   return clamp_t(s64, out, 0, ARISTA_FAN_COOLING_MAX_STATE);
+}
+
+static void thermal_apply(struct thermal_data *data, u8 pwm)
+{
+   struct thermal_cooling_device *cdev;
+   int err;
+   int i;
+
+   for (i = 0; i < data->cdev_count; i++) {
+      cdev = data->cdevs[i];
+      // the thermal core holds this lock around its own state changes
+      mutex_lock(&cdev->lock);
+      err = cdev->ops->set_cur_state(cdev, pwm);
+      mutex_unlock(&cdev->lock);
+      if (err) {
+         dev_warn_ratelimited(&data->pdev->dev,
+                              "failed to set %s to %u error=%d\n",
+                              dev_name(&cdev->device), pwm, err);
+      }
+   }
+
+   data->pwm = pwm;
+}
+
+static void thermal_work_start(struct thermal_data *data)
+{
+   queue_delayed_work(thermal_workqueue, &data->dwork,
+                      msecs_to_jiffies(data->interval_ms));
+}
+
+static void thermal_work_fn(struct work_struct *work)
+{
+   struct delayed_work *dwork = to_delayed_work(work);
+   struct thermal_data *data = container_of(dwork, struct thermal_data, dwork);
+   struct thermal_sensor sensors[MAX_SENSORS];
+   int pwm = ARISTA_FAN_COOLING_MAX_STATE;
+   int count;
+   int temp;
+   int err;
+
+   mutex_lock(&data->lock);
+   count = data->sensor_count;
+   memcpy(sensors, data->sensors, count * sizeof(*sensors));
+   mutex_unlock(&data->lock);
+
+   // the zones are read without our lock, the thermal core calls our unbind
+   // with its list lock held and the zone lookup takes that lock too
+   err = thermal_read_temp(data, sensors, count, &temp);
+
+   mutex_lock(&data->lock);
+   data->temp_valid = !err;
+   if (!err)
+      data->temp = temp;
+
+   if (data->mode != THERMAL_MODE_OFF) {
+      // without any temperature the fans are set to full speed
+      if (!err && data->mode == THERMAL_MODE_TABLE)
+         pwm = thermal_table_pwm(data, temp);
+      else if (!err && data->mode == THERMAL_MODE_PID)
+         pwm = thermal_pid_pwm(data, temp);
+      thermal_apply(data, max_t(int, pwm, data->min_pwm));
+   }
+
+   thermal_work_start(data);
+   mutex_unlock(&data->lock);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 3, 0)
+static int thermal_get_temp(struct thermal_zone_device *tz, int *temp)
+#else
+static int thermal_get_temp(struct thermal_zone_device *tz, unsigned long *temp)
+#endif
+{
+   struct thermal_data *data = tz->devdata;
+   int err = 0;
+
+   mutex_lock(&data->lock);
+   if (data->temp_valid)
+      *temp = data->temp;
+   else
+      err = -ENODATA;
+   mutex_unlock(&data->lock);
+
+   return err;
+}
+
+// the zone has no trip points, binding only tells which fans to drive
+static int thermal_bind(struct thermal_zone_device *tz,
+                        struct thermal_cooling_device *cdev)
+{
+   struct thermal_data *data = tz->devdata;
+   int err = 0;
+
+   if (strcmp(cdev->type, ARISTA_FAN_COOLING_TYPE))
+      return 0;
+
+   mutex_lock(&data->lock);
+   if (data->cdev_count < MAX_COOLING_DEVICES) {
+      data->cdevs[data->cdev_count++] = cdev;
+      dev_info(&data->pdev->dev, "driving cooling device %s\n",
+               dev_name(&cdev->device));
+   } else {
+      err = -ENOSPC;
+   }
+   mutex_unlock(&data->lock);
+
+   return err;
+}
+
+static int thermal_unbind(struct thermal_zone_device *tz,
+                          struct thermal_cooling_device *cdev)
+{
+   struct thermal_data *data = tz->devdata;
+   int i;
+
+   mutex_lock(&data->lock);
+   for (i = 0; i < data->cdev_count; i++) {
+      if (data->cdevs[i] != cdev)
+         continue;
+      data->cdevs[i] = data->cdevs[--data->cdev_count];
+      data->cdevs[data->cdev_count] = NULL;
+      break;
+   }
+   mutex_unlock(&data->lock);
+
+   return 0;
+}
+
+static struct thermal_zone_device_ops thermal_ops = {
+   .get_temp = thermal_get_temp,
+   .bind = thermal_bind,
+   .unbind = thermal_unbind,
+};
+
+// keep the zone out of hwmon, the platforms rely on the hwmon numbering
+static struct thermal_zone_params thermal_params = {
+   .no_hwmon = true,
+};
+
+static ssize_t sensors_show(struct device *dev, struct device_attribute *attr,
+                            char *buf)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   ssize_t size = 0;
+   int i;
+
+   mutex_lock(&data->lock);
+   for (i = 0; i < data->sensor_count; i++) {
+      if (data->sensors[i].i2c) {
+         size += scnprintf(buf + size, PAGE_SIZE - size, "%s:%02x\n",
+                           data->sensors[i].name, data->sensors[i].reg);
+      } else {
+         size += scnprintf(buf + size, PAGE_SIZE - size, "%s\n",
+                           data->sensors[i].name);
+      }
+   }
+   mutex_unlock(&data->lock);
+
+   return size;
+}
+
+static int sensor_parse(struct thermal_sensor *sensor, char *tok)
+{
+   char *reg = strchr(tok, ':');
+   int err;
+
+   if (reg) {
+      *reg++ = '\0';
+      err = kstrtou8(reg, 16, &sensor->reg);
+      if (err)
+         return err;
+      sensor->i2c = true;
+   }
+
+   // our own zone only reports what the loop read from the others
+   if (!*tok || strlen(tok) >= THERMAL_NAME_LENGTH ||
+       (!sensor->i2c && !strcmp(tok, DRIVER_NAME)))
+      return -EINVAL;
+
+   strcpy(sensor->name, tok);
+   return 0;
+}
+
+static ssize_t sensors_store(struct device *dev, struct device_attribute *attr,
+                             const char *buf, size_t count)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   struct thermal_sensor *sensors;
+   ssize_t res = count;
+   char *copy;
+   char *ptr;
+   char *tok;
+   int n = 0;
+   int err;
+
+   copy = kstrndup(buf, count, GFP_KERNEL);
+   sensors = kcalloc(MAX_SENSORS, sizeof(*sensors), GFP_KERNEL);
+   if (!copy || !sensors) {
+      res = -ENOMEM;
+      goto out;
+   }
+
+   ptr = copy;
+   while ((tok = strsep(&ptr, " \n"))) {
+      if (!*tok)
+         continue;
+      if (n == MAX_SENSORS) {
+         res = -EINVAL;
+         goto out;
+      }
+      err = sensor_parse(&sensors[n++], tok);
+      if (err) {
+         res = err;
+         goto out;
+      }
+   }
+
+   mutex_lock(&data->lock);
+   memcpy(data->sensors, sensors, n * sizeof(*sensors));
+   data->sensor_count = n;
+   data->temp_valid = false;
+   mutex_unlock(&data->lock);
+
+out:
+   kfree(sensors);
+   kfree(copy);
+   return res;
+}
+
+static DEVICE_ATTR(sensors, S_IRUGO|S_IWUSR|S_IWGRP, sensors_show,
+                   sensors_store);
+
+static ssize_t mode_show(struct device *dev, struct device_attribute *attr,
+                         char *buf)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   return sprintf(buf, "%s\n", thermal_mode_names[data->mode]);
+}
+
+static ssize_t mode_store(struct device *dev, struct device_attribute *attr,
+                          const char *buf, size_t count)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   int i;
+
+   for (i = 0; i < ARRAY_SIZE(thermal_mode_names); i++) {
+      if (!sysfs_streq(buf, thermal_mode_names[i]))
+         continue;
+
+      mutex_lock(&data->lock);
+      data->mode = i;
+      data->pid.integral = 0;
+      data->pid.primed = false;
+      mutex_unlock(&data->lock);
+      return count;
+   }
+
+   return -EINVAL;
+}
+
+static DEVICE_ATTR(mode, S_IRUGO|S_IWUSR|S_IWGRP, mode_show, mode_store);
+
+static ssize_t table_show(struct device *dev, struct device_attribute *attr,
+                          char *buf)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   ssize_t size = 0;
+   int i;
+
+   mutex_lock(&data->lock);
+   for (i = 0; i < data->table_len; i++) {
+      size += scnprintf(buf + size, PAGE_SIZE - size, "%s%d:%u",
+                        i ? " " : "", data->table[i].temp, data->table[i].pwm);
+   }
+   size += scnprintf(buf + size, PAGE_SIZE - size, "\n");
+   mutex_unlock(&data->lock);
+
+   return size;
+}
+
+static ssize_t table_store(struct device *dev, struct device_attribute *attr,
+                           const char *buf, size_t count)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   struct thermal_point table[MAX_TABLE_POINTS];
+   ssize_t res = count;
+   char *copy;
+   char *ptr;
+   char *tok;
+   int n = 0;
+
+   copy = kstrndup(buf, count, GFP_KERNEL);
+   if (!copy)
+      return -ENOMEM;
+
+   ptr = copy;
+   while ((tok = strsep(&ptr, " \n"))) {
+      if (!*tok)
+         continue;
+      if (n == MAX_TABLE_POINTS ||
+          sscanf(tok, "%d:%hhu", &table[n].temp, &table[n].pwm) != 2 ||
+          (n && table[n].temp <= table[n - 1].temp)) {
+         res = -EINVAL;
+         goto out;
+      }
+      n++;
+   }
+
+   mutex_lock(&data->lock);
+   memcpy(data->table, table, n * sizeof(*table));
+   data->table_len = n;
+   mutex_unlock(&data->lock);
+
+out:
+   kfree(copy);
+   return res;
+}
+
+static DEVICE_ATTR(table, S_IRUGO|S_IWUSR|S_IWGRP, table_show, table_store);
+
+static ssize_t pid_show(struct device *dev, struct device_attribute *attr,
+                        char *buf)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   struct thermal_pid *pid = &data->pid;
+   ssize_t res;
+
+   mutex_lock(&data->lock);
+   res = sprintf(buf, "%d %d %d %d\n", pid->setpoint, pid->kp, pid->ki,
+                 pid->kd);
+   mutex_unlock(&data->lock);
+
+   return res;
+}
+
+static ssize_t pid_store(struct device *dev, struct device_attribute *attr,
+                         const char *buf, size_t count)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   struct thermal_pid *pid = &data->pid;
+   int setpoint, kp, ki, kd;
+
+   if (sscanf(buf, "%d %d %d %d", &setpoint, &kp, &ki, &kd) != 4)
+      return -EINVAL;
+
+   mutex_lock(&data->lock);
+   pid->setpoint = setpoint;
+   pid->kp = kp;
+   pid->ki = ki;
+   pid->kd = kd;
+   pid->integral = 0;
+   pid->primed = false;
+   mutex_unlock(&data->lock);
+
+   return count;
+}
+
+static DEVICE_ATTR(pid, S_IRUGO|S_IWUSR|S_IWGRP, pid_show, pid_store);
+
+static ssize_t min_pwm_show(struct device *dev, struct device_attribute *attr,
+                            char *buf)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   return sprintf(buf, "%u\n", data->min_pwm);
+}
+
+static ssize_t min_pwm_store(struct device *dev, struct device_attribute *attr,
+                             const char *buf, size_t count)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   u8 val;
+   int err;
+
+   err = kstrtou8(buf, 10, &val);
+   if (err)
+      return err;
+
+   mutex_lock(&data->lock);
+   data->min_pwm = val;
+   mutex_unlock(&data->lock);
+
+   return count;
+}
+
+static DEVICE_ATTR(min_pwm, S_IRUGO|S_IWUSR|S_IWGRP, min_pwm_show,
+                   min_pwm_store);
+
+static ssize_t interval_ms_show(struct device *dev,
+                                struct device_attribute *attr, char *buf)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   return sprintf(buf, "%lu\n", data->interval_ms);
+}
+
+static ssize_t interval_ms_store(struct device *dev,
+                                 struct device_attribute *attr,
+                                 const char *buf, size_t count)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   unsigned long val;
+   int err;
+
+   err = kstrtoul(buf, 10, &val);
+   if (err)
+      return err;
+
+   if (val < MIN_INTERVAL_MS)
+      return -EINVAL;
+
+   mutex_lock(&data->lock);
+   data->interval_ms = val;
+   data->pid.primed = false;
+   mutex_unlock(&data->lock);
+
+   return count;
+}
+
+static DEVICE_ATTR(interval_ms, S_IRUGO|S_IWUSR|S_IWGRP, interval_ms_show,
+                   interval_ms_store);
+
+static ssize_t temp_show(struct device *dev, struct device_attribute *attr,
+                         char *buf)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   ssize_t res = -ENODATA;
+
+   mutex_lock(&data->lock);
+   if (data->temp_valid)
+      res = sprintf(buf, "%d\n", data->temp);
+   mutex_unlock(&data->lock);
+
+   return res;
+}
+
+static DEVICE_ATTR(temp, S_IRUGO, temp_show, NULL);
+
+static ssize_t pwm_show(struct device *dev, struct device_attribute *attr,
+                        char *buf)
+{
+   struct thermal_data *data = dev_get_drvdata(dev);
+   return sprintf(buf, "%u\n", data->pwm);
+}
+
+static DEVICE_ATTR(pwm, S_IRUGO, pwm_show, NULL);
+
+static struct attribute *thermal_attrs[] = {
+   &dev_attr_sensors.attr,
+   &dev_attr_mode.attr,
+   &dev_attr_table.attr,
+   &dev_attr_pid.attr,
+   &dev_attr_min_pwm.attr,
+   &dev_attr_interval_ms.attr,
+   &dev_attr_temp.attr,
+   &dev_attr_pwm.attr,
+   NULL,
+};
+
+static struct attribute_group thermal_group = {
+   .attrs = thermal_attrs,
+};
+
+static void thermal_remove(struct platform_device *pdev)
+{
+   struct thermal_data *data = platform_get_drvdata(pdev);
+
+   sysfs_remove_group(&pdev->dev.kobj, &thermal_group);
+   cancel_delayed_work_sync(&data->dwork);
+   thermal_zone_device_unregister(data->tz);
+}
+
+static int thermal_probe(struct platform_device *pdev)
+{
+   struct thermal_data *data;
+   int err;
+
+   data = devm_kzalloc(&pdev->dev, sizeof(*data), GFP_KERNEL);
+   if (!data)
+      return -ENOMEM;
+
+   data->pdev = pdev;
+   data->mode = THERMAL_MODE_OFF;
+   data->interval_ms = max_t(unsigned long, interval_ms, MIN_INTERVAL_MS);
+   mutex_init(&data->lock);
+   INIT_DELAYED_WORK(&data->dwork, thermal_work_fn);
+   platform_set_drvdata(pdev, data);
+
+   data->tz = thermal_zone_device_register(DRIVER_NAME, 0, 0, data,
+                                           &thermal_ops, &thermal_params, 0, 0);
+   if (IS_ERR(data->tz)) {
+      dev_err(&pdev->dev, "failed to register the thermal zone\n");
+      return PTR_ERR(data->tz);
+   }
+
+   err = sysfs_create_group(&pdev->dev.kobj, &thermal_group);
+   if (err) {
+      thermal_zone_device_unregister(data->tz);
+      return err;
+   }
+
+   thermal_work_start(data);
+
+   return 0;
+}
+
+static int __init arista_thermal_init(void)
+{
+   struct platform_device *pdev;
+   int err;
+
+   thermal_workqueue = create_singlethread_workqueue(DRIVER_NAME);
+   if (!thermal_workqueue) {
+      pr_err("failed to initialize workqueue\n");
+      return -ENOMEM;
+   }
+
+   pdev = platform_device_register_simple(DRIVER_NAME, -1, NULL, 0);
+   if (IS_ERR(pdev)) {
+      pr_err("failed to register " DRIVER_NAME "\n");
+      err = PTR_ERR(pdev);
+      goto fail_pdev;
+   }
+
+   err = thermal_probe(pdev);
+   if (err) {
+      dev_err(&pdev->dev, "failed to init device\n");
+      goto fail_probe;
+   }
+
+   thermal_pdev = pdev;
+
+   return 0;
+
+fail_probe:
+   platform_device_unregister(pdev);
+fail_pdev:
+   destroy_workqueue(thermal_workqueue);
+   thermal_workqueue = NULL;
+   return err;
+}
+
+static void __exit arista_thermal_exit(void)
+{
+   if (!thermal_pdev) {
+      return;
+   }
+
+   thermal_remove(thermal_pdev);
+   platform_device_unregister(thermal_pdev);
+   thermal_pdev = NULL;
+
+   destroy_workqueue(thermal_workqueue);
+   thermal_workqueue = NULL;
+}
+
+module_init(arista_thermal_init);
+module_exit(arista_thermal_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Arista Networks");
+MODULE_DESCRIPTION("Arista closed loop fan control");
@@ -0,0 +1,12 @@
+#ifndef _LINUX_DRIVER_ARISTA_THERMAL_H_
+#define _LINUX_DRIVER_ARISTA_THERMAL_H_
+
+/*
+ * The fan drivers register their fans as thermal cooling devices of this type,
+ * the cooling state is the pwm applied to all the fans of the device.
+ * arista-thermal drives every cooling device of this type.
+ */
+#define ARISTA_FAN_COOLING_TYPE "arista-fan"
+#define ARISTA_FAN_COOLING_MAX_STATE 255
+
+#endif /* _LINUX_DRIVER_ARISTA_THERMAL_H_ */
@@ -20,6 +20,11 @@
 #include <linux/hwmon.h>
 #include <linux/hwmon-sysfs.h>
 #include <linux/leds.h>
+#include <linux/thermal.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+
+#include "arista-thermal.h"
 
 #define DRIVER_NAME "crow-cpld-fans"
 
@@ -55,6 +60,26 @@
 #define FAN_LED_RED 2
 #define FAN_LED_YELLOW 3
 
+#define CPLD_REG_COUNT (SCRATCHREG + 1)
+
+static unsigned long sample_interval = 1000;
+module_param(sample_interval, ulong, S_IRUSR);
+MODULE_PARM_DESC(sample_interval, "interval between two samplings of the cpld "
+                 "registers in ms, 0 to read them on every access");
+
+// registers read by the background sampling, everything the attributes report
+static const struct {
+    u8 start;
+    u8 count;
+} sampled_ranges[] = {
+    { TACH1LOWREG, 8 },
+    { FAN1PWMREG, 4 },
+    { FAN1IDREG, 4 },
+    { FANPRESENTREG, 1 },
+    { FANGREENLEDREG, 2 },
+    { CROWCPLDREVREG, 1 },
+};
+
 struct crow_led {
     char name[LED_NAME_MAX_SZ];
     struct led_classdev cdev;
@@ -64,17 +89,42 @@ struct crow_led {
 struct crow_cpld_data {
     struct i2c_client *client;
     struct crow_led leds[NUM_FANS];
+    struct thermal_cooling_device *cooling;
+
+    // snapshot of the sampled registers, reads are served from it once valid
+    bool block_reads;
+    struct mutex lock;
+    struct delayed_work dwork;
+    u8 regs[CPLD_REG_COUNT];
+    bool sampled;
+    unsigned long sample_time;
 };
 
-static s32 read_cpld(struct device *dev, u8 reg, char *buf)
+static const u8 fan_pwm_regs[NUM_FANS] = {
+    FAN1PWMREG, FAN2PWMREG, FAN3PWMREG, FAN4PWMREG
+};
+
+static bool reg_sampled(u8 reg)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(sampled_ranges); i++) {
+        if (reg >= sampled_ranges[i].start &&
+            reg < sampled_ranges[i].start + sampled_ranges[i].count)
+            return true;
+    }
+
+    return false;
+}
+
+static s32 read_cpld_hw(struct crow_cpld_data *data, u8 reg, u8 *buf)
 {
     int err;
-    struct crow_cpld_data *data = dev_get_drvdata(dev);
-    struct i2c_client *client = data->client;
 
-    err = i2c_smbus_read_byte_data(client, reg);
+    err = i2c_smbus_read_byte_data(data->client, reg);
     if (err < 0) {
-        dev_err(dev, "failed to read reg %d of with error code: %d\n", reg, err);
+        dev_err(&data->client->dev,
+                "failed to read reg %d of with error code: %d\n", reg, err);
         return err;
     }
 
@@ -82,21 +132,110 @@ static s32 read_cpld(struct device *dev, u8 reg, char *buf)
     return 0;
 }
 
+static s32 read_cpld_block_hw(struct crow_cpld_data *data, u8 reg, u8 count,
+                              u8 *buf)
+{
+    int err;
+    int i;
+
+    if (!data->block_reads) {
+        for (i = 0; i < count; i++) {
+            err = read_cpld_hw(data, reg + i, &buf[i]);
+            if (err)
+                return err;
+        }
+        return 0;
+    }
+
+    err = i2c_smbus_read_i2c_block_data(data->client, reg, count, buf);
+    if (err < 0) {
+        dev_err(&data->client->dev,
+                "failed to read %d regs from %d with error code: %d\n",
+                count, reg, err);
+        return err;
+    }
+
+    if (err != count)
+        return -EIO;
+
+    return 0;
+}
+
+// reads all the sampled registers in one pass, one transaction per range
+static s32 read_cpld_regs(struct crow_cpld_data *data, u8 *regs)
+{
+    s32 err;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(sampled_ranges); i++) {
+        err = read_cpld_block_hw(data, sampled_ranges[i].start,
+                                 sampled_ranges[i].count,
+                                 regs + sampled_ranges[i].start);
+        if (err)
+            return err;
+    }
+
+    return 0;
+}
+
+static s32 read_cpld(struct device *dev, u8 reg, char *buf)
+{
+    struct crow_cpld_data *data = dev_get_drvdata(dev);
+
+    mutex_lock(&data->lock);
+    if (data->sampled && reg_sampled(reg)) {
+        *buf = data->regs[reg];
+        mutex_unlock(&data->lock);
+        return 0;
+    }
+    mutex_unlock(&data->lock);
+
+    return read_cpld_hw(data, reg, buf);
+}
+
 static s32 write_cpld(struct device *dev, u8 reg, u8 byte)
 {
     int err;
     struct crow_cpld_data *data = dev_get_drvdata(dev);
     struct i2c_client *client = data->client;
 
+    mutex_lock(&data->lock);
     err = i2c_smbus_write_byte_data(client, reg, byte);
     if (err) {
         dev_err(dev, "failed to write %02x in reg %02x of with error code: %d\n",
                 byte, reg, err);
+    } else if (reg_sampled(reg)) {
+        data->regs[reg] = byte;
     }
+    mutex_unlock(&data->lock);
 
     return err;
 }
 
+static void sample_work_start(struct crow_cpld_data *data)
+{
+    schedule_delayed_work(&data->dwork, msecs_to_jiffies(sample_interval));
+}
+
+static void sample_cpld(struct crow_cpld_data *data)
+{
+    mutex_lock(&data->lock);
+    // on failure the reads go to the hardware until the next good sampling
+    data->sampled = !read_cpld_regs(data, data->regs);
+    data->sample_time = jiffies;
+    mutex_unlock(&data->lock);
+}
+
+static void sample_work_fn(struct work_struct *work)
+{
+    struct delayed_work *dwork = to_delayed_work(work);
+    struct crow_cpld_data *data = container_of(dwork, struct crow_cpld_data,
+                                               dwork);
+
+    sample_cpld(data);
+    sample_work_start(data);
+}
+
 static s32 read_cpld_buf(struct device *dev, u8 reg, char *buf)
 {
     s32 status;
@@ -124,32 +263,37 @@ static s32 write_cpld_buf(struct device *dev, u8 reg, const char *buf)
     return status;
 }
 
+static u8 led_color_from_regs(u8 green, u8 red, int index)
+{
+    unsigned char read_value_g = (green >> index) & 0x01;
+    unsigned char read_value_r = (red >> index) & 0x01;
+
+    if((!read_value_g) && read_value_r) {
+       return FAN_LED_GREEN;
+    } else if (read_value_g && (!read_value_r)) {
+       return FAN_LED_RED;
+    } else if((!read_value_g) && (!read_value_r)) {
+       return FAN_LED_YELLOW;
+    }
+
+    return FAN_LED_OFF;
+}
+
 static s32 read_led_color(struct device *dev, int index, u8 *color)
 {
     s32 err;
-    u8 data;
-    unsigned char read_value_g = 0;
-    unsigned char read_value_r = 0;
+    u8 green;
+    u8 red;
 
-    err = read_cpld(dev, FANGREENLEDREG, &data);
+    err = read_cpld(dev, FANGREENLEDREG, &green);
     if (err)
         return err;
-    read_value_g = (data >> index) & 0x01;
 
-    err = read_cpld(dev, FANREDLEDREG, &data);
+    err = read_cpld(dev, FANREDLEDREG, &red);
     if (err)
         return err;
-    read_value_r = (data >> index) & 0x01;
-
-    *color = FAN_LED_OFF;
-    if((!read_value_g) && read_value_r) {
-       *color = FAN_LED_GREEN;
-    } else if (read_value_g && (!read_value_r)) {
-       *color = FAN_LED_RED;
-    } else if((!read_value_g) && (!read_value_r)) {
-       *color = FAN_LED_YELLOW;
-    }
 
+    *color = led_color_from_regs(green, red, index);
     return 0;
 }
 
@@ -235,25 +379,38 @@ static s32 write_led_color_buf(struct device *dev, const char *buf, int index)
     return write_led_color(dev, value, index);
 }
 
+static u32 tach_to_speed(u8 dataHigh, u8 dataLow)
+{
+    u32 tachData = (dataHigh << 8) + dataLow;
+
+    if (!tachData) {
+        tachData = 1;
+    }
+
+    return (6000000 / tachData) / 2;
+}
+
 static s32 read_tach(struct device *dev, u8 tachHigh, u8 tachLow, u32 *speed)
 {
+    struct crow_cpld_data *data = dev_get_drvdata(dev);
     s32 status;
-    u8 dataHigh;
-    u8 dataLow;
-    u32 tachData;
+    u8 vals[2];
 
-    status = read_cpld(dev, tachHigh, &dataHigh);
-    status |= read_cpld(dev, tachLow, &dataLow);
+    mutex_lock(&data->lock);
+    if (data->sampled) {
+        *speed = tach_to_speed(data->regs[tachHigh], data->regs[tachLow]);
+        mutex_unlock(&data->lock);
+        return 0;
+    }
+    mutex_unlock(&data->lock);
+
+    // both bytes in one transaction so that the value can't be torn
+    status = read_cpld_block_hw(data, tachLow, 2, vals);
     if (status) {
         return status;
     }
 
-    tachData = (dataHigh << 8) + dataLow;
-    if (!tachData) {
-        tachData = 1;
-    }
-    *speed = 6000000 / tachData;
-    *speed = *speed / 2;
+    *speed = tach_to_speed(vals[1], vals[0]);
 
     return 0;
 }
@@ -366,6 +523,58 @@ static ssize_t crow_cpld_rev_show(struct device *dev,
 
 DEVICE_ATTR(crow_cpld_rev, S_IRUGO, crow_cpld_rev_show, NULL);
 
+static ssize_t age_show(struct device *dev, struct device_attribute *attr,
+                        char *buf)
+{
+    struct crow_cpld_data *data = dev_get_drvdata(dev);
+    ssize_t res = -ENODATA;
+
+    mutex_lock(&data->lock);
+    if (data->sampled)
+        res = sprintf(buf, "%u\n",
+                      jiffies_to_msecs(jiffies - data->sample_time));
+    mutex_unlock(&data->lock);
+
+    return res;
+}
+
+DEVICE_ATTR(age, S_IRUGO, age_show, NULL);
+
+// the whole fan tray from a single snapshot of the registers
+static ssize_t state_show(struct device *dev, struct device_attribute *attr,
+                          char *buf)
+{
+    struct crow_cpld_data *data = dev_get_drvdata(dev);
+    u8 regs[CPLD_REG_COUNT];
+    ssize_t size = 0;
+    s32 err = 0;
+    int i;
+
+    mutex_lock(&data->lock);
+    if (data->sampled)
+        memcpy(regs, data->regs, sizeof(regs));
+    else
+        err = read_cpld_regs(data, regs);
+    mutex_unlock(&data->lock);
+    if (err)
+        return err;
+
+    for (i = 0; i < NUM_FANS; i++) {
+        size += scnprintf(buf + size, PAGE_SIZE - size,
+                          "fan%d present %d input %u pwm %u id %u led %u\n",
+                          i + 1, ~(regs[FANPRESENTREG] >> i) & 0x01,
+                          tach_to_speed(regs[TACH1HIGHREG + i * 2],
+                                        regs[TACH1LOWREG + i * 2]),
+                          regs[FAN1PWMREG + i], regs[FAN1IDREG + i],
+                          led_color_from_regs(regs[FANGREENLEDREG],
+                                              regs[FANREDLEDREG], i));
+    }
+
+    return size;
+}
+
+DEVICE_ATTR(state, S_IRUGO, state_show, NULL);
+
 FAN_DEVICE_ATTR(1);
 FAN_DEVICE_ATTR(2);
 FAN_DEVICE_ATTR(3);
@@ -385,6 +594,8 @@ static struct attribute *fan_attrs[] = {
     FANATTR(3)
     FANATTR(4)
     &dev_attr_crow_cpld_rev.attr,
+    &dev_attr_age.attr,
+    &dev_attr_state.attr,
     NULL,
 };
 
@@ -448,10 +659,62 @@ static int leds_init(struct crow_led *leds, struct i2c_client *client)
     return 0;
 }
 
+static int cooling_get_max_state(struct thermal_cooling_device *cdev,
+                                 unsigned long *state)
+{
+    *state = ARISTA_FAN_COOLING_MAX_STATE;
+    return 0;
+}
+
+static int cooling_get_cur_state(struct thermal_cooling_device *cdev,
+                                 unsigned long *state)
+{
+    struct crow_cpld_data *data = cdev->devdata;
+    u8 pwm;
+    int err;
+
+    err = read_cpld(&data->client->dev, FAN1PWMREG, &pwm);
+    if (err)
+        return err;
+
+    *state = pwm;
+    return 0;
+}
+
+static int cooling_set_cur_state(struct thermal_cooling_device *cdev,
+                                 unsigned long state)
+{
+    struct crow_cpld_data *data = cdev->devdata;
+    int err;
+    int i;
+
+    if (state > ARISTA_FAN_COOLING_MAX_STATE)
+        return -EINVAL;
+
+    for (i = 0; i < NUM_FANS; i++) {
+        err = write_cpld(&data->client->dev, fan_pwm_regs[i], state);
+        if (err)
+            return err;
+    }
+
+    return 0;
+}
+
+static struct thermal_cooling_device_ops cooling_ops = {
+    .get_max_state = cooling_get_max_state,
+    .get_cur_state = cooling_get_cur_state,
+    .set_cur_state = cooling_set_cur_state,
+};
+
 static int crow_cpld_remove(struct i2c_client *client)
 {
     struct crow_cpld_data *data = i2c_get_clientdata(client);
 
+    cancel_delayed_work_sync(&data->dwork);
+
+    if (!IS_ERR_OR_NULL(data->cooling))
+        thermal_cooling_device_unregister(data->cooling);
+
     leds_unregister(data, NUM_FANS);
 
     return 0;
@@ -470,6 +733,11 @@ static int crow_cpld_probe(struct i2c_client *client,
 
     i2c_set_clientdata(client, data);
     data->client = client;
+    data->block_reads = i2c_check_functionality(client->adapter,
+                                                I2C_FUNC_SMBUS_READ_I2C_BLOCK);
+    mutex_init(&data->lock);
+    INIT_DELAYED_WORK(&data->dwork, sample_work_fn);
+
     hwmon_dev = devm_hwmon_device_register_with_groups(dev, client->name,
                                                        data, fan_groups);
     if (IS_ERR(hwmon_dev))
@@ -479,6 +747,17 @@ static int crow_cpld_probe(struct i2c_client *client,
     if (err)
         return err;
 
+    if (sample_interval) {
+        sample_cpld(data);
+        sample_work_start(data);
+    }
+
+    // the fans keep being driven through the pwm attributes without it
+    data->cooling = thermal_cooling_device_register(ARISTA_FAN_COOLING_TYPE,
+                                                    data, &cooling_ops);
+    if (IS_ERR(data->cooling))
+        dev_warn(dev, "failed to register the cooling device\n");
+
     return 0;
 }
 
@@ -0,0 +1,431 @@
+/* Copyright (c) 2026 Arista Networks, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Decoder for the prefdl stored in the system eeprom.
+ *
+ * The prefdl is ascii: a fixed section starting with the format version ("0002"
+ * or "0003"), a list of tlvs made of a 2 digit hex type and a 4 digit hex length
+ * followed by the value, an END tlv and finally the crc32 of everything before
+ * it as 8 hex digits.  Version 0002 also holds the serial number in its 30 bytes
+ * long fixed section, version 0003 only has the version.
+ *
+ * The eeprom is read and decoded once at probe time.  The sku, mac and
+ * serial_number attributes hold the decoded fields and the prefdl binary
+ * attribute the raw data, up to and including the crc.  There is no detection,
+ * the platform creates the device with new_device as "prefdl".
+ */
+
+#include <linux/module.h>
+#include <linux/device.h>
+#include <linux/i2c.h>
+#include <linux/slab.h>
+#include <linux/ctype.h>
+#include <linux/crc32.h>
+#include <linux/string.h>
+
+#define DRIVER_NAME "prefdl-eeprom"
+
+#define PREFDL_SIZE 256
+
+#define PREFDL_VERSION_SIZE 4
+#define PREFDL_FIXED_V2_SIZE 30
+#define PREFDL_FIXED_V3_SIZE 4
+#define PREFDL_SERIAL_OFFSET 16
+#define PREFDL_SERIAL_SIZE 11
+
+#define PREFDL_TLV_TYPE_SIZE 2
+#define PREFDL_TLV_LENGTH_SIZE 4
+#define PREFDL_TLV_HEADER_SIZE (PREFDL_TLV_TYPE_SIZE + PREFDL_TLV_LENGTH_SIZE)
+#define PREFDL_CRC_SIZE 8
+
+#define PREFDL_TLV_END    0x00
+#define PREFDL_TLV_SKU    0x03
+#define PREFDL_TLV_MAC    0x05
+#define PREFDL_TLV_SERIAL 0x0E
+
+#define PREFDL_FIELD_MAX_SZ 64
+#define PREFDL_MAC_SZ 12
+
+struct prefdl_data {
+   struct i2c_client *client;
+
+   u8 raw[PREFDL_SIZE];
+   size_t len;
+   u32 crc;
+
+   char sku[PREFDL_FIELD_MAX_SZ];
+   char mac[PREFDL_MAC_SZ + PREFDL_MAC_SZ / 2];
+   char serial[PREFDL_FIELD_MAX_SZ];
+
+   struct bin_attribute bin_attr;
+};
+
+static int prefdl_read_eeprom(struct i2c_client *client, u8 *buf, size_t size)
+{
+   bool block = i2c_check_functionality(client->adapter,
+                                        I2C_FUNC_SMBUS_READ_I2C_BLOCK);
+   size_t off = 0;
+   int ret;
+
+   while (off < size) {
+      if (block) {
+         ret = i2c_smbus_read_i2c_block_data(client, off,
+                                             min_t(size_t, size - off,
+                                                   I2C_SMBUS_BLOCK_MAX),
+                                             buf + off);
+         if (ret <= 0)
+            return ret ? ret : -EIO;
+         off += ret;
+      } else {
+         ret = i2c_smbus_read_byte_data(client, off);
+         if (ret < 0)
+            return ret;
+         buf[off++] = ret;
+      }
+   }
+
+   return 0;
+}
+
+static bool prefdl_valid_version(const u8 *buf)
+{
+   return !memcmp(buf, "0002", PREFDL_VERSION_SIZE) ||
+          !memcmp(buf, "0003", PREFDL_VERSION_SIZE);
+}
+
+static int prefdl_parse_hex(const u8 *buf, size_t len, u32 *value)
+{
+   char tmp[PREFDL_CRC_SIZE + 1];
+
+   if (len >= sizeof(tmp))
+      return -EINVAL;
+
+   memcpy(tmp, buf, len);
+   tmp[len] = '\0';
+
+   return kstrtou32(tmp, 16, value);
+}
+
+// the python decoder strips each chunk of the fixed section before computing the
+// crc, do the same to agree on what a valid prefdl is
+static u32 prefdl_crc_stripped(u32 crc, const u8 *buf, size_t len)
+{
+   while (len && isspace(*buf)) {
+      buf++;
+      len--;
+   }
+   while (len && isspace(buf[len - 1]))
+      len--;
+
+   return crc32_le(crc, buf, len);
+}
+
+static void prefdl_copy_field(char *dst, size_t size, const u8 *buf, size_t len)
+{
+   len = min(len, size - 1);
+   memcpy(dst, buf, len);
+   dst[len] = '\0';
+}
+
+// serial numbers of the fixed section are 3 letters, 4 digits and 4 letters or
+// digits, dashes and spaces are ignored
+static void prefdl_parse_fixed_serial(struct prefdl_data *prefdl)
+{
+   const u8 *buf = prefdl->raw + PREFDL_SERIAL_OFFSET;
+   char serial[PREFDL_SERIAL_SIZE + 1];
+   size_t len = 0;
+   size_t i;
+
+   for (i = 0; i < PREFDL_SERIAL_SIZE; i++) {
+      if (buf[i] == ' ' || buf[i] == '-')
+         continue;
+      serial[len++] = toupper(buf[i]);
+   }
+   serial[len] = '\0';
+
+   if (len != PREFDL_SERIAL_SIZE)
+      goto invalid;
+   for (i = 0; i < len; i++) {
+      if (i < 3 && !isupper(serial[i]))
+         goto invalid;
+      if (i >= 3 && i < 7 && !isdigit(serial[i]))
+         goto invalid;
+      if (i >= 7 && !isupper(serial[i]) && !isdigit(serial[i]))
+         goto invalid;
+   }
+
+   snprintf(prefdl->serial, sizeof(prefdl->serial), "%s", serial);
+   return;
+
+invalid:
+   dev_warn(&prefdl->client->dev, "invalid serial number in fixed section\n");
+}
+
+static void prefdl_parse_mac(struct prefdl_data *prefdl, const u8 *buf,
+                             size_t len)
+{
+   char *p = prefdl->mac;
+   size_t i;
+
+   if (len != PREFDL_MAC_SZ) {
+      dev_warn(&prefdl->client->dev, "invalid mac address length %zu\n", len);
+      return;
+   }
+
+   for (i = 0; i < len; i += 2) {
+      if (i)
+         *p++ = ':';
+      *p++ = buf[i];
+      *p++ = buf[i + 1];
+   }
+   *p = '\0';
+}
+
+static int prefdl_decode(struct prefdl_data *prefdl)
+{
+   struct device *dev = &prefdl->client->dev;
+   const u8 *buf = prefdl->raw;
+   size_t fixed_size;
+   size_t off;
+   u32 type, length;
+   u32 crc;
+   int err;
+
+   if (!prefdl_valid_version(buf)) {
+      dev_err(dev, "unsupported prefdl version %.4s\n", buf);
+      return -EINVAL;
+   }
+
+   crc = prefdl_crc_stripped(~0, buf, PREFDL_VERSION_SIZE);
+   if (!memcmp(buf, "0002", PREFDL_VERSION_SIZE)) {
+      fixed_size = PREFDL_FIXED_V2_SIZE;
+      crc = prefdl_crc_stripped(crc, buf + PREFDL_VERSION_SIZE,
+                                fixed_size - PREFDL_VERSION_SIZE);
+      prefdl_parse_fixed_serial(prefdl);
+   } else {
+      fixed_size = PREFDL_FIXED_V3_SIZE;
+   }
+
+   off = fixed_size;
+   while (true) {
+      if (off + PREFDL_TLV_HEADER_SIZE > PREFDL_SIZE)
+         goto truncated;
+
+      err = prefdl_parse_hex(buf + off, PREFDL_TLV_TYPE_SIZE, &type);
+      if (!err)
+         err = prefdl_parse_hex(buf + off + PREFDL_TLV_TYPE_SIZE,
+                                PREFDL_TLV_LENGTH_SIZE, &length);
+      if (err) {
+         dev_err(dev, "invalid tlv header at offset %zu\n", off);
+         return -EINVAL;
+      }
+
+      if (off + PREFDL_TLV_HEADER_SIZE + length > PREFDL_SIZE)
+         goto truncated;
+
+      crc = crc32_le(crc, buf + off, PREFDL_TLV_HEADER_SIZE + length);
+      off += PREFDL_TLV_HEADER_SIZE;
+
+      switch (type) {
+      case PREFDL_TLV_SKU:
+         prefdl_copy_field(prefdl->sku, sizeof(prefdl->sku), buf + off, length);
+         break;
+      case PREFDL_TLV_MAC:
+         prefdl_parse_mac(prefdl, buf + off, length);
+         break;
+      case PREFDL_TLV_SERIAL:
+         prefdl_copy_field(prefdl->serial, sizeof(prefdl->serial), buf + off,
+                           length);
+         break;
+      }
+
+      off += length;
+      if (type == PREFDL_TLV_END)
+         break;
+   }
+
+   if (off + PREFDL_CRC_SIZE > PREFDL_SIZE)
+      goto truncated;
+
+   err = prefdl_parse_hex(buf + off, PREFDL_CRC_SIZE, &prefdl->crc);
+   if (err) {
+      dev_err(dev, "invalid crc at offset %zu\n", off);
+      return -EINVAL;
+   }
+
+   crc ^= ~0;
+   if (crc != prefdl->crc) {
+      dev_err(dev, "invalid crc -- saw %08X expected %08X\n", prefdl->crc, crc);
+      return -EINVAL;
+   }
+
+   prefdl->len = off + PREFDL_CRC_SIZE;
+   return 0;
+
+truncated:
+   dev_err(dev, "prefdl does not fit in the eeprom\n");
+   return -EINVAL;
+}
+
+static ssize_t prefdl_field_show(char *buf, const char *field)
+{
+   if (!*field)
+      return -ENODATA;
+   return sprintf(buf, "%s\n", field);
+}
+
+static ssize_t sku_show(struct device *dev, struct device_attribute *attr,
+                        char *buf)
+{
+   struct prefdl_data *prefdl = dev_get_drvdata(dev);
+   return prefdl_field_show(buf, prefdl->sku);
+}
+
+static ssize_t mac_show(struct device *dev, struct device_attribute *attr,
+                        char *buf)
+{
+   struct prefdl_data *prefdl = dev_get_drvdata(dev);
+   return prefdl_field_show(buf, prefdl->mac);
+}
+
+static ssize_t serial_number_show(struct device *dev,
+                                  struct device_attribute *attr, char *buf)
+{
+   struct prefdl_data *prefdl = dev_get_drvdata(dev);
+   return prefdl_field_show(buf, prefdl->serial);
+}
+
+static ssize_t crc_show(struct device *dev, struct device_attribute *attr,
+                        char *buf)
+{
+   struct prefdl_data *prefdl = dev_get_drvdata(dev);
+   return sprintf(buf, "%08X\n", prefdl->crc);
+}
+
+static DEVICE_ATTR(sku, S_IRUGO, sku_show, NULL);
+static DEVICE_ATTR(mac, S_IRUGO, mac_show, NULL);
+static DEVICE_ATTR(serial_number, S_IRUGO, serial_number_show, NULL);
+static DEVICE_ATTR(crc, S_IRUGO, crc_show, NULL);
+
+static struct attribute *prefdl_attrs[] = {
+   &dev_attr_sku.attr,
+   &dev_attr_mac.attr,
+   &dev_attr_serial_number.attr,
+   &dev_attr_crc.attr,
+   NULL,
+};
+
+static struct attribute_group prefdl_group = {
+   .attrs = prefdl_attrs,
+};
+
+static ssize_t prefdl_bin_read(struct file *filp, struct kobject *kobj,
+                               struct bin_attribute *attr, char *buf,
+                               loff_t off, size_t count)
+{
+   struct device *dev = container_of(kobj, struct device, kobj);
+   struct prefdl_data *prefdl = dev_get_drvdata(dev);
+
+   if (off >= prefdl->len)
+      return 0;
+   count = min_t(size_t, count, prefdl->len - off);
+   memcpy(buf, prefdl->raw + off, count);
+
+   return count;
+}
+
+static int prefdl_probe(struct i2c_client *client,
+                        const struct i2c_device_id *id)
+{
+   struct device *dev = &client->dev;
+   struct prefdl_data *prefdl;
+   int err;
+
+   if (!i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_READ_BYTE_DATA)) {
+      dev_err(dev, "adapter doesn't support byte transactions\n");
+      return -ENODEV;
+   }
+
+   prefdl = devm_kzalloc(dev, sizeof(*prefdl), GFP_KERNEL);
+   if (!prefdl)
+      return -ENOMEM;
+
+   prefdl->client = client;
+   i2c_set_clientdata(client, prefdl);
+
+   err = prefdl_read_eeprom(client, prefdl->raw, sizeof(prefdl->raw));
+   if (err) {
+      dev_err(dev, "failed to read the eeprom (%d)\n", err);
+      return err;
+   }
+
+   err = prefdl_decode(prefdl);
+   if (err)
+      return err;
+
+   err = sysfs_create_group(&dev->kobj, &prefdl_group);
+   if (err)
+      return err;
+
+   sysfs_bin_attr_init(&prefdl->bin_attr);
+   prefdl->bin_attr.attr.name = "prefdl";
+   prefdl->bin_attr.attr.mode = S_IRUGO;
+   prefdl->bin_attr.size = prefdl->len;
+   prefdl->bin_attr.read = prefdl_bin_read;
+
+   err = sysfs_create_bin_file(&dev->kobj, &prefdl->bin_attr);
+   if (err) {
+      sysfs_remove_group(&dev->kobj, &prefdl_group);
+      return err;
+   }
+
+   dev_info(dev, "sku %s serial %s\n", prefdl->sku, prefdl->serial);
+
+   return 0;
+}
+
+static int prefdl_remove(struct i2c_client *client)
+{
+   struct prefdl_data *prefdl = i2c_get_clientdata(client);
+
+   sysfs_remove_bin_file(&client->dev.kobj, &prefdl->bin_attr);
+   sysfs_remove_group(&client->dev.kobj, &prefdl_group);
+
+   return 0;
+}
+
+static const struct i2c_device_id prefdl_id[] = {
+   { "prefdl", 0 },
+   {}
+};
+
+MODULE_DEVICE_TABLE(i2c, prefdl_id);
+
+static struct i2c_driver prefdl_driver = {
+   .driver = {
+      .name = DRIVER_NAME,
+   },
+   .id_table = prefdl_id,
+   .probe = prefdl_probe,
+   .remove = prefdl_remove,
+};
+
+module_i2c_driver(prefdl_driver);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Arista Networks");
+MODULE_DESCRIPTION("Prefdl system eeprom decoder");
@@ -22,7 +22,9 @@
 #include <linux/hwmon-sysfs.h>
 #include <linux/platform_device.h>
 #include <linux/leds.h>
+#include <linux/thermal.h>
 #include "gpio-kversfix.h"
+#include "arista-thermal.h"
 
 #define DRIVER_NAME "sb800-fans"
 
@@ -83,6 +85,7 @@ struct raven_led {
 struct raven_pdata {
    struct device *hwmon_dev;
    struct raven_led leds[NUM_FANS];
+   struct thermal_cooling_device *cooling;
    u8 *gpio_base;
    u8 *pm2_base;
 };
@@ -375,6 +378,47 @@ static struct attribute *fan_attrs[] = {
 
 ATTRIBUTE_GROUPS(fan);
 
+static u8 *fan_pwm_reg(struct raven_pdata *pdata, u32 fan_id)
+{
+   return pdata->pm2_base + FAN_PWM_BASE_ADDR + (fan_id * FAN_PWM_ADDR_OFFSET);
+}
+
+static int cooling_get_max_state(struct thermal_cooling_device *cdev,
+                                 unsigned long *state)
+{
+   *state = ARISTA_FAN_COOLING_MAX_STATE;
+   return 0;
+}
+
+static int cooling_get_cur_state(struct thermal_cooling_device *cdev,
+                                 unsigned long *state)
+{
+   struct raven_pdata *pdata = cdev->devdata;
+   *state = ioread8(fan_pwm_reg(pdata, 0));
+   return 0;
+}
+
+static int cooling_set_cur_state(struct thermal_cooling_device *cdev,
+                                 unsigned long state)
+{
+   struct raven_pdata *pdata = cdev->devdata;
+   int num_fan;
+
+   if (state > ARISTA_FAN_COOLING_MAX_STATE)
+      return -EINVAL;
+
+   for (num_fan = 0; num_fan < NUM_FANS; num_fan++)
+      iowrite8(state, fan_pwm_reg(pdata, num_fan));
+
+   return 0;
+}
+
+static struct thermal_cooling_device_ops cooling_ops = {
+   .get_max_state = cooling_get_max_state,
+   .get_cur_state = cooling_get_cur_state,
+   .set_cur_state = cooling_set_cur_state,
+};
+
 static void set_led_init_state(struct device * dev)
 {
    int num_fan;
@@ -422,6 +466,9 @@ static int sb_fan_remove(struct platform_device *pdev)
    int err = 0;
    struct raven_pdata *pdata = platform_get_drvdata(pdev);
 
+   if (!IS_ERR_OR_NULL(pdata->cooling))
+      thermal_cooling_device_unregister(pdata->cooling);
+
    leds_unregister(pdata, NUM_FANS);
 
    iounmap(pdata->gpio_base);
@@ -470,6 +517,12 @@ static s32 sb_fan_probe(struct platform_device *pdev)
       goto fail_hwmon_register;
    }
 
+   // the fans keep being driven through the pwm attributes without it
+   pdata->cooling = thermal_cooling_device_register(ARISTA_FAN_COOLING_TYPE,
+                                                    pdata, &cooling_ops);
+   if (IS_ERR(pdata->cooling))
+      dev_warn(&pdev->dev, "failed to register the cooling device\n");
+
    return ret;
 
 fail_hwmon_register:
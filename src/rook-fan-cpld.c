@@ -23,6 +23,10 @@
 #include <linux/slab.h>
 #include <linux/workqueue.h>
 #include <linux/leds.h>
+#include <linux/thermal.h>
+#include <linux/jiffies.h>
+
+#include "arista-thermal.h"
 
 #define DRIVER_NAME "rook-fan-cpld"
 
@@ -62,6 +66,18 @@
 #define FAN_LED_GREEN 1
 #define FAN_LED_RED 2
 
+#define CPLD_REG_COUNT (FAN_OK_CHNG_REG + 1)
+
+// contiguous register ranges read with a single transaction by the sampling
+static const struct {
+   u8 start;
+   u8 count;
+} cpld_blocks[] = {
+   { FAN_TACH_A_REG_LOW(0), 0x20 }, // tach of both rotors
+   { FAN_PWM_A_REG(0), 0x10 },      // pwm of both rotors
+   { FAN_ID_REG(0), 0x10 },         // ids, status, leds and interrupts
+};
+
 static bool managed_leds = true;
 module_param(managed_leds, bool, S_IRUSR | S_IWUSR);
 MODULE_PARM_DESC(managed_leds, "let the driver handle the leds");
@@ -70,6 +86,11 @@ static unsigned long poll_interval = 0;
 module_param(poll_interval, ulong, S_IRUSR);
 MODULE_PARM_DESC(poll_interval, "interval between two polling in ms");
 
+static unsigned long sample_interval = 1000;
+module_param(sample_interval, ulong, S_IRUSR);
+MODULE_PARM_DESC(sample_interval, "interval between two samplings of the fans "
+                 "in ms, 0 to read them on every access");
+
 static struct workqueue_struct *rook_cpld_workqueue;
 
 enum cpld_type {
@@ -99,8 +120,12 @@ struct cpld_fan_data {
    struct led_classdev cdev;
    bool ok;
    bool present;
+   // from the last sampling, ok and present are left to cpld_update
+   bool sampled_ok;
+   bool sampled_present;
    bool forward;
    u16 tach;
+   s32 tach_err;
    u8 pwm;
    u8 ident;
    u8 index;
@@ -114,6 +139,14 @@ struct cpld_data {
    struct device *hwmon_dev;
    struct delayed_work dwork;
    struct cpld_fan_data fans[MAX_FAN_COUNT];
+   struct thermal_cooling_device *cooling;
+
+   // the attributes are served from the last sampling once there is one
+   struct delayed_work sample_work;
+   bool sampled;
+   unsigned long sample_time;
+   bool block_reads;
+   u8 regs[CPLD_REG_COUNT];
 
    const struct attribute_group *groups[1 + MAX_FAN_COUNT + 1];
 
@@ -155,6 +188,33 @@ static s32 cpld_read_byte(struct cpld_data *cpld, u8 reg, u8 *res)
    return 0;
 }
 
+static s32 cpld_read_block(struct cpld_data *cpld, u8 reg, u8 count, u8 *buf)
+{
+   int err;
+   int i;
+
+   if (!cpld->block_reads) {
+      for (i = 0; i < count; i++) {
+         err = cpld_read_byte(cpld, reg + i, &buf[i]);
+         if (err)
+            return err;
+      }
+      return 0;
+   }
+
+   err = i2c_smbus_read_i2c_block_data(cpld->client, reg, count, buf);
+   if (err < 0) {
+      dev_err(&cpld->client->dev,
+              "failed to read %d regs from 0x%02x error=%d\n", count, reg, err);
+      return err;
+   }
+
+   if (err != count)
+      return -EIO;
+
+   return 0;
+}
+
 static s32 cpld_write_byte(struct cpld_data *cpld, u8 reg, u8 byte)
 {
    int err;
@@ -371,18 +431,14 @@ static s32 cpld_read_tach_single(struct cpld_data *cpld, u8 fan_id, u8 fan_num,
                                  u16 *tach)
 {
    int err;
-   u8 low;
-   u8 high;
+   u8 vals[2];
 
-   err = cpld_read_byte(cpld, FAN_TACH_REG_LOW(fan_id, fan_num), &low);
+   // both bytes in one transaction so that the value can't be torn
+   err = cpld_read_block(cpld, FAN_TACH_REG_LOW(fan_id, fan_num), 2, vals);
    if (err)
       return err;
 
-   err = cpld_read_byte(cpld, FAN_TACH_REG_HIGH(fan_id, fan_num), &high);
-   if (err)
-      return err;
-
-   *tach = ((u16)high << 8) | low;
+   *tach = ((u16)vals[1] << 8) | vals[0];
 
    return 0;
 }
@@ -442,6 +498,65 @@ static s32 cpld_read_fan_pwm(struct cpld_data *cpld, u8 fan_id)
    return 0;
 }
 
+// reads everything the attributes report with a few block reads and decodes it,
+// the state cpld_update detects the changes against is not touched
+static int cpld_sample(struct cpld_data *cpld)
+{
+   struct cpld_fan_data *fan;
+   u8 *regs = cpld->regs;
+   int err;
+   int i;
+   int j;
+
+   for (i = 0; i < ARRAY_SIZE(cpld_blocks); i++) {
+      err = cpld_read_block(cpld, cpld_blocks[i].start, cpld_blocks[i].count,
+                            regs + cpld_blocks[i].start);
+      // the attributes go back to reading the cpld until a sampling succeeds
+      if (err) {
+         cpld->sampled = false;
+         return err;
+      }
+   }
+
+   for (i = 0; i < cpld->info->fan_count; ++i) {
+      fan = fan_from_cpld(cpld, i);
+      fan->sampled_present = !!(regs[FAN_PRESENT_REG] & (1 << i));
+      fan->sampled_ok = !!(regs[FAN_OK_REG] & (1 << i));
+      fan->ident = regs[FAN_ID_REG(i)] & 0xf;
+      fan->forward = (regs[FAN_ID_REG(i)] >> 4) & 0x1;
+      // some fans have two rotors but we only report the 1st one
+      fan->pwm = regs[FAN_PWM_REG(i, 0)];
+
+      fan->tach_err = 0;
+      for (j = 0; j < cpld->info->rotors; j++) {
+         fan->tach = ((u16)regs[FAN_TACH_REG_HIGH(i, j)] << 8) |
+                     regs[FAN_TACH_REG_LOW(i, j)];
+         if (fan->tach == 0xffff) {
+            fan->tach_err = fan->sampled_present ? -EIO : -ENODEV;
+            break;
+         }
+      }
+   }
+
+   cpld->sampled = true;
+   cpld->sample_time = jiffies;
+
+   return 0;
+}
+
+static bool cpld_sampled(struct cpld_data *cpld)
+{
+   return sample_interval && cpld->sampled;
+}
+
+static int cpld_fan_rpms(struct cpld_data *cpld, struct cpld_fan_data *fan)
+{
+   if (!fan->tach)
+      return -EINVAL;
+
+   return ((cpld->info->hz * 60) / fan->tach) / cpld->info->pulses;
+}
+
 static s32 cpld_read_fan_led(struct cpld_data *data, u8 fan_id, u8 *val)
 {
    bool red = data->red_led & (1 << fan_id);
@@ -538,11 +653,13 @@ static ssize_t cpld_fan_pwm_show(struct device *dev, struct device_attribute *da
    struct cpld_fan_data *fan = fan_from_cpld(cpld, attr->index);
    int err;
 
-   mutex_lock(&cpld->lock);
-   err = cpld_read_fan_pwm(cpld, attr->index);
-   mutex_unlock(&cpld->lock);
-   if (err)
-      return err;
+   if (!cpld_sampled(cpld)) {
+      mutex_lock(&cpld->lock);
+      err = cpld_read_fan_pwm(cpld, attr->index);
+      mutex_unlock(&cpld->lock);
+      if (err)
+         return err;
+   }
 
    return sprintf(buf, "%hhu\n", fan->pwm);
 }
@@ -576,6 +693,9 @@ static ssize_t cpld_fan_present_show(struct device *dev,
    struct cpld_fan_data *fan = fan_from_cpld(cpld, attr->index);
    int err;
 
+   if (cpld_sampled(cpld))
+      return sprintf(buf, "%d\n", fan->sampled_present);
+
    if (!poll_interval) {
       mutex_lock(&cpld->lock);
       err = cpld_read_present(cpld);
@@ -595,7 +715,7 @@ static ssize_t cpld_fan_id_show(struct device *dev, struct device_attribute *da,
    struct cpld_fan_data *fan = fan_from_cpld(cpld, attr->index);
    int err = 0;
 
-   if (!poll_interval) {
+   if (!poll_interval && !cpld_sampled(cpld)) {
       mutex_lock(&cpld->lock);
       err = cpld_read_fan_id(cpld, attr->index);
       mutex_unlock(&cpld->lock);
@@ -614,6 +734,9 @@ static ssize_t cpld_fan_fault_show(struct device *dev, struct device_attribute *
    struct cpld_fan_data *fan = fan_from_cpld(cpld, attr->index);
    int err;
 
+   if (cpld_sampled(cpld))
+      return sprintf(buf, "%d\n", !fan->sampled_ok);
+
    if (!poll_interval) {
       mutex_lock(&cpld->lock);
       err = cpld_read_fault(cpld);
@@ -635,16 +758,17 @@ static ssize_t cpld_fan_tach_show(struct device *dev, struct device_attribute *d
    int rpms;
 
    mutex_lock(&cpld->lock);
-   err = cpld_read_fan_tach(cpld, attr->index);
+   if (cpld_sampled(cpld))
+      err = fan->tach_err;
+   else
+      err = cpld_read_fan_tach(cpld, attr->index);
    mutex_unlock(&cpld->lock);
    if (err)
       return err;
 
-   if (!fan->tach) {
-      return -EINVAL;
-   }
-
-   rpms = ((cpld->info->hz * 60) / fan->tach) / cpld->info->pulses;
+   rpms = cpld_fan_rpms(cpld, fan);
+   if (rpms < 0)
+      return rpms;
 
    return sprintf(buf, "%d\n", rpms);
 }
@@ -777,9 +901,111 @@ static ssize_t cpld_update_show(struct device *dev, struct device_attribute *att
 
 DEVICE_ATTR(update, S_IRUGO, cpld_update_show, NULL);
 
+static ssize_t cpld_age_show(struct device *dev, struct device_attribute *attr,
+                             char *buf)
+{
+   struct cpld_data *cpld = dev_get_drvdata(dev);
+   ssize_t res = -ENODATA;
+
+   mutex_lock(&cpld->lock);
+   if (cpld_sampled(cpld))
+      res = sprintf(buf, "%u\n", jiffies_to_msecs(jiffies - cpld->sample_time));
+   mutex_unlock(&cpld->lock);
+
+   return res;
+}
+
+DEVICE_ATTR(age, S_IRUGO, cpld_age_show, NULL);
+
+// the whole fan tray at once, from the same sampling
+static ssize_t cpld_state_show(struct device *dev, struct device_attribute *attr,
+                               char *buf)
+{
+   struct cpld_data *cpld = dev_get_drvdata(dev);
+   struct cpld_fan_data *fan;
+   ssize_t size = 0;
+   int err = 0;
+   int rpms;
+   u8 led;
+   int i;
+
+   mutex_lock(&cpld->lock);
+   if (!cpld_sampled(cpld))
+      err = cpld_sample(cpld);
+   if (err) {
+      mutex_unlock(&cpld->lock);
+      return err;
+   }
+
+   for (i = 0; i < cpld->info->fan_count; ++i) {
+      fan = fan_from_cpld(cpld, i);
+      rpms = fan->tach_err ? 0 : cpld_fan_rpms(cpld, fan);
+      cpld_read_fan_led(cpld, i, &led);
+      size += scnprintf(buf + size, PAGE_SIZE - size,
+                        "fan%d present %d fault %d input %d pwm %u id %u "
+                        "airflow %s led %u\n",
+                        i + 1, fan->sampled_present, !fan->sampled_ok,
+                        max(rpms, 0), fan->pwm,
+                        fan->ident, fan->forward ? "forward" : "reverse", led);
+   }
+   mutex_unlock(&cpld->lock);
+
+   return size;
+}
+
+DEVICE_ATTR(state, S_IRUGO, cpld_state_show, NULL);
+
+static int cooling_get_max_state(struct thermal_cooling_device *cdev,
+                                 unsigned long *state)
+{
+   *state = ARISTA_FAN_COOLING_MAX_STATE;
+   return 0;
+}
+
+static int cooling_get_cur_state(struct thermal_cooling_device *cdev,
+                                 unsigned long *state)
+{
+   struct cpld_data *cpld = cdev->devdata;
+
+   mutex_lock(&cpld->lock);
+   *state = fan_from_cpld(cpld, 0)->pwm;
+   mutex_unlock(&cpld->lock);
+
+   return 0;
+}
+
+static int cooling_set_cur_state(struct thermal_cooling_device *cdev,
+                                 unsigned long state)
+{
+   struct cpld_data *cpld = cdev->devdata;
+   int err = 0;
+   int i;
+
+   if (state > ARISTA_FAN_COOLING_MAX_STATE)
+      return -EINVAL;
+
+   mutex_lock(&cpld->lock);
+   for (i = 0; i < cpld->info->fan_count; ++i) {
+      err = cpld_write_pwm(cpld, i, state);
+      if (err)
+         break;
+   }
+   mutex_unlock(&cpld->lock);
+
+   return err;
+}
+
+static struct thermal_cooling_device_ops cooling_ops = {
+   .get_max_state = cooling_get_max_state,
+   .get_cur_state = cooling_get_cur_state,
+   .set_cur_state = cooling_set_cur_state,
+};
+
 static struct attribute *cpld_attrs[] = {
     &dev_attr_cpld_revision.attr,
     &dev_attr_update.attr,
+    &dev_attr_age.attr,
+    &dev_attr_state.attr,
     NULL,
 };
 
@@ -798,6 +1024,19 @@ static void cpld_work_fn(struct work_struct *work)
    mutex_unlock(&cpld->lock);
 }
 
+static void cpld_sample_work_fn(struct work_struct *work)
+{
+   struct delayed_work *dwork = to_delayed_work(work);
+   struct cpld_data *cpld = container_of(dwork, struct cpld_data, sample_work);
+
+   mutex_lock(&cpld->lock);
+   cpld_sample(cpld);
+   mutex_unlock(&cpld->lock);
+
+   queue_delayed_work(rook_cpld_workqueue, &cpld->sample_work,
+                      msecs_to_jiffies(sample_interval));
+}
+
 static int cpld_init(struct cpld_data *cpld)
 {
    struct cpld_fan_data *fan;
@@ -852,6 +1091,13 @@ static int cpld_init(struct cpld_data *cpld)
    INIT_DELAYED_WORK(&cpld->dwork, cpld_work_fn);
    cpld_work_start(cpld);
 
+   INIT_DELAYED_WORK(&cpld->sample_work, cpld_sample_work_fn);
+   if (sample_interval) {
+      cpld_sample(cpld);
+      queue_delayed_work(rook_cpld_workqueue, &cpld->sample_work,
+                         msecs_to_jiffies(sample_interval));
+   }
+
    return err;
 }
 
@@ -877,6 +1123,8 @@ static int cpld_probe(struct i2c_client *client,
    cpld->client = client;
 
    cpld->info = &cpld_infos[id->driver_data];
+   cpld->block_reads = i2c_check_functionality(client->adapter,
+                                               I2C_FUNC_SMBUS_READ_I2C_BLOCK);
    mutex_init(&cpld->lock);
 
    cpld->groups[0] = &cpld_group;
@@ -894,14 +1142,27 @@ static int cpld_probe(struct i2c_client *client,
    mutex_lock(&cpld->lock);
    err = cpld_init(cpld);
    mutex_unlock(&cpld->lock);
+   if (err)
+      return err;
 
-   return err;
+   // the fans keep being driven through the pwm attributes without it
+   cpld->cooling = thermal_cooling_device_register(ARISTA_FAN_COOLING_TYPE,
+                                                   cpld, &cooling_ops);
+   if (IS_ERR(cpld->cooling))
+      dev_warn(dev, "failed to register the cooling device\n");
+
+   return 0;
 }
 
 static int cpld_remove(struct i2c_client *client)
 {
    struct cpld_data *cpld = i2c_get_clientdata(client);
 
+   if (!IS_ERR_OR_NULL(cpld->cooling))
+      thermal_cooling_device_unregister(cpld->cooling);
+
+   cancel_delayed_work_sync(&cpld->sample_work);
+
    mutex_lock(&cpld->lock);
    cancel_delayed_work_sync(&cpld->dwork);
    mutex_unlock(&cpld->lock);
@@ -0,0 +1,115 @@
+/* Copyright (c) 2017 Arista Networks, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// tracepoints of the scd-hwmon driver, see /sys/kernel/debug/tracing/events/scd_hwmon
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM scd_hwmon
+
+#if !defined(_SCD_HWMON_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _SCD_HWMON_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+// classes of smbus errors reported by the response register
+#define SMBUS_ERROR_NONE      0
+#define SMBUS_ERROR_FE        1
+#define SMBUS_ERROR_ACK       2
+#define SMBUS_ERROR_TIMEOUT   3
+#define SMBUS_ERROR_CONFLICT  4
+#define SMBUS_ERROR_FLUSH     5
+#define SMBUS_ERROR_TID       6
+
+#define show_smbus_error(err)                      \
+   __print_symbolic(err,                           \
+                    { SMBUS_ERROR_NONE, "none" },  \
+                    { SMBUS_ERROR_FE, "fe" },      \
+                    { SMBUS_ERROR_ACK, "ack" },    \
+                    { SMBUS_ERROR_TIMEOUT, "timeout" }, \
+                    { SMBUS_ERROR_CONFLICT, "conflict" }, \
+                    { SMBUS_ERROR_FLUSH, "flush" }, \
+                    { SMBUS_ERROR_TID, "tid" })
+
+TRACE_EVENT(scd_smbus_start,
+   TP_PROTO(u32 master, u32 bus, u16 addr, char read_write, u8 command, int size),
+   TP_ARGS(master, bus, addr, read_write, command, size),
+   TP_STRUCT__entry(
+      __field(u32, master)
+      __field(u32, bus)
+      __field(u16, addr)
+      __field(char, read_write)
+      __field(u8, command)
+      __field(int, size)
+   ),
+   TP_fast_assign(
+      __entry->master = master;
+      __entry->bus = bus;
+      __entry->addr = addr;
+      __entry->read_write = read_write;
+      __entry->command = command;
+      __entry->size = size;
+   ),
+   TP_printk("master=%u bus=%u addr=0x%02x %s reg=0x%02x size=%d",
+             __entry->master, __entry->bus, __entry->addr,
+             __entry->read_write ? "read" : "write", __entry->command,
+             __entry->size)
+);
+
+TRACE_EVENT(scd_smbus_complete,
+   TP_PROTO(u32 master, u32 bus, u16 addr, int ret, int error, u64 latency_ns),
+   TP_ARGS(master, bus, addr, ret, error, latency_ns),
+   TP_STRUCT__entry(
+      __field(u32, master)
+      __field(u32, bus)
+      __field(u16, addr)
+      __field(int, ret)
+      __field(int, error)
+      __field(u64, latency_ns)
+   ),
+   TP_fast_assign(
+      __entry->master = master;
+      __entry->bus = bus;
+      __entry->addr = addr;
+      __entry->ret = ret;
+      __entry->error = error;
+      __entry->latency_ns = latency_ns;
+   ),
+   TP_printk("master=%u bus=%u addr=0x%02x ret=%d error=%s latency=%lluns",
+             __entry->master, __entry->bus, __entry->addr, __entry->ret,
+             show_smbus_error(__entry->error),
+             (unsigned long long)__entry->latency_ns)
+);
+
+TRACE_EVENT(scd_smbus_master_reset,
+   TP_PROTO(u32 master),
+   TP_ARGS(master),
+   TP_STRUCT__entry(
+      __field(u32, master)
+   ),
+   TP_fast_assign(
+      __entry->master = master;
+   ),
+   TP_printk("master=%u", __entry->master)
+);
+
+#endif /* _SCD_HWMON_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE scd-hwmon-trace
+#include <trace/define_trace.h>
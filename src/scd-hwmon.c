@@ -27,10 +27,20 @@
 #include <linux/i2c.h>
 #include <linux/pci.h>
 #include <linux/stat.h>
+#include <linux/vmalloc.h>
+#include <linux/async.h>
+#include <linux/completion.h>
+#include <linux/netdevice.h>
+#include <linux/spinlock.h>
+#include <linux/regmap.h>
+#include <linux/sched.h>
 
 #include "scd.h"
 #include "scd-hwmon.h"
 
+#define CREATE_TRACE_POINTS
+#include "scd-hwmon-trace.h"
+
 #define SCD_MODULE_NAME "scd-hwmon"
 
 #define SMBUS_REQUEST_OFFSET 0x10
@@ -59,6 +69,14 @@ struct scd_master {
    struct list_head bus_list;
 
    int max_retries;
+
+   // the master is driven from userspace through resource0, hands off as long
+   // as the process that took it, owner, is alive
+   bool user_owned;
+   struct pid *owner;
+
+   // done once the initial reset of the master, run asynchronously, is over
+   struct completion ready;
 };
 
 struct bus_params {
@@ -86,13 +104,26 @@ struct scd_bus {
 };
 
 #define LED_NAME_MAX_SZ 40
+
+#define SCD_LED_BLINK 0x04000000
+
+static unsigned long led_blink_ms = 500;
+module_param(led_blink_ms, ulong, S_IRUSR);
+MODULE_PARM_DESC(led_blink_ms, "on and off time in ms of the hardware led blink");
+
 struct scd_led {
    struct scd_context *ctx;
    struct list_head list;
 
    u32 addr;
+   u16 index;
    char name[LED_NAME_MAX_SZ];
    struct led_classdev cdev;
+
+   // link state binding used by the scd-netdev trigger, see scd_netdev_lock
+   char netdev[IFNAMSIZ];
+   u8 link_color;
+   bool netdev_active;
 };
 
 struct scd_gpio_attribute {
@@ -166,6 +197,8 @@ struct scd_reset {
 struct scd_context {
    struct pci_dev *pdev;
    size_t res_size;
+   // used by the sysfs attributes, serializes their read-modify-write
+   struct regmap *regmap;
 
    struct list_head list;
 
@@ -176,6 +209,16 @@ struct scd_context {
    struct list_head reset_list;
    struct list_head led_list;
    struct list_head master_list;
+
+   // leds by index for the led bank attributes
+   struct scd_led **leds;
+   size_t led_count;
+   size_t led_table_size;
+
+   // binary configuration being received through new_object_bin
+   u8 *config;
+   size_t config_len;
+   size_t config_size;
 };
 
 union request_reg {
@@ -294,34 +337,40 @@ static union response_reg smbus_master_read_resp(struct scd_master *master)
    return resp;
 }
 
-static s32 smbus_check_resp(union response_reg resp, u32 tid)
+static s32 smbus_check_resp(union response_reg resp, u32 tid, int *error_class)
 {
    const char *error;
    int error_ret = -EIO;
 
    if (resp.reg == 0xffffffff) {
       error = "fe";
+      *error_class = SMBUS_ERROR_FE;
       error_ret = -EAGAIN;
       goto fail;
    }
    if (resp.ack_error) {
       error = "ack";
+      *error_class = SMBUS_ERROR_ACK;
       goto fail;
    }
    if (resp.timeout_error) {
       error = "timeout";
+      *error_class = SMBUS_ERROR_TIMEOUT;
       goto fail;
    }
    if (resp.bus_conflict_error) {
       error = "conflict";
+      *error_class = SMBUS_ERROR_CONFLICT;
       goto fail;
    }
    if (resp.flushed) {
       error = "flush";
+      *error_class = SMBUS_ERROR_FLUSH;
       goto fail;
    }
    if (resp.ti != tid) {
       error = "tid";
+      *error_class = SMBUS_ERROR_TID;
       error_ret = -EAGAIN;
       goto fail;
    }
@@ -343,11 +392,12 @@ static u32 scd_smbus_func(struct i2c_adapter *adapter)
 static void smbus_master_reset(struct scd_master *master)
 {
    union ctrl_status_reg cs;
+   trace_scd_smbus_master_reset(master->id);
    cs = smbus_master_read_cs(master);
    cs.reset = 1;
    cs.foe = 1;
    smbus_master_write_cs(master, cs);
-   mdelay(10);
+   msleep(10);
    cs.reset = 0;
    smbus_master_write_cs(master, cs);
 }
@@ -366,6 +416,42 @@ static const struct bus_params *get_bus_params(struct scd_bus *bus, u16 addr) {
    return params;
 }
 
+// true while the process that took the master from the kernel is alive
+static bool smbus_master_owner_alive(struct scd_master *master)
+{
+   struct task_struct *task;
+   bool alive;
+
+   rcu_read_lock();
+   task = pid_task(master->owner, PIDTYPE_PID);
+   alive = task && !(task->flags & PF_EXITING);
+   rcu_read_unlock();
+
+   return alive;
+}
+
+// master lock is held, changes the owner of the master
+static void smbus_master_set_owner(struct scd_master *master, bool user_owned)
+{
+   if (master->user_owned && !user_owned) {
+      smbus_master_reset(master);
+   }
+
+   put_pid(master->owner);
+   master->owner = user_owned ? get_pid(task_tgid(current)) : NULL;
+   master->user_owned = user_owned;
+}
+
+// master lock is held, takes the master back if its userspace owner is gone
+static void smbus_master_check_owner(struct scd_master *master)
+{
+   if (master->user_owned && !smbus_master_owner_alive(master)) {
+      scd_warn("owner of smbus master %u exited, giving it back to the kernel\n",
+               master->id);
+      smbus_master_set_owner(master, false);
+   }
+}
+
 static s32 scd_smbus_do(struct scd_bus *bus, u16 addr, unsigned short flags,
                         char read_write, u8 command, int size,
                         union i2c_smbus_data *data)
@@ -378,9 +464,21 @@ static s32 scd_smbus_do(struct scd_bus *bus, u16 addr, unsigned short flags,
    int ret = 0;
    u32 ss = 0;
    u32 data_offset = 0;
+   int error_class = SMBUS_ERROR_NONE;
+   ktime_t start;
 
+   wait_for_completion(&master->ready);
    master_lock(master);
 
+   smbus_master_check_owner(master);
+   if (master->user_owned) {
+      master_unlock(master);
+      return -EBUSY;
+   }
+
+   trace_scd_smbus_start(master->id, bus->id, addr, read_write, command, size);
+   start = ktime_get();
+
    params = get_bus_params(bus, addr);
 
    req.reg = 0;
@@ -427,6 +525,10 @@ static s32 scd_smbus_do(struct scd_bus *bus, u16 addr, unsigned short flags,
          if (ret) {
             goto fail;
          }
+         if (data->block[0] > I2C_SMBUS_BLOCK_MAX) {
+            ret = -EPROTO;
+            goto fail;
+         }
          ss = 4 + data->block[0];
       }
       break;
@@ -473,7 +575,7 @@ static s32 scd_smbus_do(struct scd_bus *bus, u16 addr, unsigned short flags,
    req.ti = 0;
    for (i = 0; i < ss; i++) {
       resp = smbus_master_read_resp(master);
-      ret = smbus_check_resp(resp, req.ti);
+      ret = smbus_check_resp(resp, req.ti, &error_class);
       if (ret) {
          goto fail;
       }
@@ -501,10 +603,14 @@ static s32 scd_smbus_do(struct scd_bus *bus, u16 addr, unsigned short flags,
       }
    }
 
+   trace_scd_smbus_complete(master->id, bus->id, addr, 0, SMBUS_ERROR_NONE,
+                            ktime_to_ns(ktime_sub(ktime_get(), start)));
    master_unlock(master);
    return 0;
 
 fail:
+   trace_scd_smbus_complete(master->id, bus->id, addr, ret, error_class,
+                            ktime_to_ns(ktime_sub(ktime_get(), start)));
    scd_warn("smbus %s failed addr=0x%02x reg=0x%02x size=0x%02x adapter=\"%s\"\n",
             (read_write) ? "read" : "write", addr, command, size, bus->adap.name);
    smbus_master_reset(master);
@@ -613,6 +719,8 @@ static void scd_smbus_master_remove(struct scd_master *master)
    struct bus_params *params;
    struct bus_params *tmp_params;
 
+   wait_for_completion(&master->ready);
+
    list_for_each_entry_safe(bus, tmp_bus, &master->bus_list, list) {
       i2c_del_adapter(&bus->adap);
 
@@ -626,6 +734,8 @@ static void scd_smbus_master_remove(struct scd_master *master)
    }
 
    smbus_master_reset(master);
+   scd_regmap_remove_range(master->ctx->pdev, master->resp, master->resp);
+   put_pid(master->owner);
 
    list_del(&master->list);
    kfree(master);
@@ -641,6 +751,23 @@ static void scd_smbus_remove_all(struct scd_context *ctx)
    }
 }
 
+static void scd_smbus_master_reset_async(void *data, async_cookie_t cookie)
+{
+   struct scd_master *master = data;
+
+   master_lock(master);
+   smbus_master_reset(master);
+   master_unlock(master);
+
+   complete_all(&master->ready);
+}
+
+/*
+ * The adapters are registered right away, in order, so that bus numbers stay the
+ * same from one boot to the other.  Resetting the master takes a while and is
+ * done asynchronously so that all masters are brought up in parallel.
+ * Transactions on the master wait until it is ready.
+ */
 static int scd_smbus_master_add(struct scd_context *ctx, u32 addr, u32 id,
                                 u32 bus_count)
 {
@@ -660,6 +787,7 @@ static int scd_smbus_master_add(struct scd_context *ctx, u32 addr, u32 id,
    }
 
    master->ctx = ctx;
+   INIT_LIST_HEAD(&master->list);
    mutex_init(&master->mutex);
    master->id = id;
    master->req = addr + SMBUS_REQUEST_OFFSET;
@@ -667,6 +795,15 @@ static int scd_smbus_master_add(struct scd_context *ctx, u32 addr, u32 id,
    master->resp = addr + SMBUS_RESPONSE_OFFSET;
    master->max_retries = MASTER_DEFAULT_MAX_RETRIES;
    INIT_LIST_HEAD(&master->bus_list);
+   init_completion(&master->ready);
+
+   // reading the response register pops the fifo, keep the regmap dump off it
+   err = scd_regmap_add_range(ctx->pdev, master->resp, master->resp,
+                              SCD_REGMAP_PRECIOUS);
+   if (err) {
+      scd_dbg("no regmap range for master %d response (%d)\n", id, err);
+      err = 0;
+   }
 
    for (i = 0; i < bus_count; ++i) {
       err = scd_smbus_bus_add(master, i);
@@ -675,21 +812,20 @@ static int scd_smbus_master_add(struct scd_context *ctx, u32 addr, u32 id,
       }
    }
 
-   smbus_master_reset(master);
-
    list_add_tail(&master->list, &ctx->master_list);
 
+   async_schedule(scd_smbus_master_reset_async, master);
+
    return 0;
 
 fail_bus:
+   complete_all(&master->ready);
    scd_smbus_master_remove(master);
    return err;
 }
 
-static void led_brightness_set(struct led_classdev *led_cdev,
-                               enum led_brightness value)
+static u32 led_color_reg(enum led_brightness value)
 {
-   struct scd_led *led = container_of(led_cdev, struct scd_led, cdev);
    u32 reg;
 
    switch ((int)value) {
@@ -718,8 +854,170 @@ static void led_brightness_set(struct led_classdev *led_cdev,
       reg = 0x1806ff00;
       break;
    }
-   scd_write_register(led->ctx->pdev, led->addr, reg);
+   return reg;
+}
+
+static void led_brightness_set(struct led_classdev *led_cdev,
+                               enum led_brightness value)
+{
+   struct scd_led *led = container_of(led_cdev, struct scd_led, cdev);
+   scd_write_register(led->ctx->pdev, led->addr, led_color_reg(value));
+}
+
+/*
+ * The blink bit of the led register makes the scd blink the led on its own at a
+ * fixed rate, brightness 4 to 6 are the blinking versions of colors 1 to 3.
+ * Blink requests at that rate are offloaded, the led core falls back to
+ * blinking in software for the others.
+ */
+static void scd_led_hw_blink(struct scd_led *led, enum led_brightness color)
+{
+   if (color >= 4 && color <= 6)
+      color -= 3;
+   if (color < 1 || color > 3)
+      color = 1;
+   scd_write_register(led->ctx->pdev, led->addr,
+                      led_color_reg(color) | SCD_LED_BLINK);
+}
+
+static int led_blink_set(struct led_classdev *led_cdev, unsigned long *delay_on,
+                         unsigned long *delay_off)
+{
+   struct scd_led *led = container_of(led_cdev, struct scd_led, cdev);
+
+   if (!*delay_on && !*delay_off) {
+      *delay_on = led_blink_ms;
+      *delay_off = led_blink_ms;
+   } else if (*delay_on != led_blink_ms || *delay_off != led_blink_ms) {
+      return -EINVAL;
+   }
+
+   scd_led_hw_blink(led, led_cdev->brightness);
+   return 0;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+// only an endless on/off pattern at the hardware rate can be offloaded
+static int led_pattern_set(struct led_classdev *led_cdev,
+                           struct led_pattern *pattern, u32 len, int repeat)
+{
+   struct scd_led *led = container_of(led_cdev, struct scd_led, cdev);
+
+   if (len != 2 || repeat != -1)
+      return -EINVAL;
+   if (!pattern[0].brightness || pattern[1].brightness)
+      return -EINVAL;
+   if (pattern[0].delta_t != led_blink_ms || pattern[1].delta_t != led_blink_ms)
+      return -EINVAL;
+
+   scd_led_hw_blink(led, pattern[0].brightness);
+   return 0;
+}
+
+static int led_pattern_clear(struct led_classdev *led_cdev)
+{
+   struct scd_led *led = container_of(led_cdev, struct scd_led, cdev);
+   scd_write_register(led->ctx->pdev, led->addr, led_color_reg(LED_OFF));
+   return 0;
+}
+#endif
+
+// used by the led bank, keeps the led class device in sync
+static void scd_led_set(struct scd_led *led, u8 color)
+{
+   led->cdev.brightness = color;
+   scd_write_register(led->ctx->pdev, led->addr, led_color_reg(color));
+}
+
+/*
+ * The scd-netdev trigger drives port leds from the carrier state of the
+ * netdevs they are bound to, without going through userspace on link changes.
+ * The bindings are uploaded once through the led_netdev attribute and only
+ * apply to the leds that use the trigger.
+ *
+ * led_classdev_unregister runs the trigger deactivation with the scd lock
+ * held, so the binding of a led is protected by its own spinlock instead.
+ */
+static DEFINE_SPINLOCK(scd_netdev_lock);
+
+#define SCD_LED_LINK_COLOR_DEFAULT 1
+
+static u8 scd_netdev_led_color(struct net_device *ndev, u8 link_color)
+{
+   if (netif_running(ndev) && netif_carrier_ok(ndev))
+      return link_color;
+   return LED_OFF;
+}
+
+static void scd_led_netdev_refresh(struct scd_led *led)
+{
+   struct net_device *ndev;
+   char name[IFNAMSIZ];
+   u8 link_color;
+   bool active;
+
+   spin_lock(&scd_netdev_lock);
+   active = led->netdev_active;
+   link_color = led->link_color;
+   memcpy(name, led->netdev, sizeof(name));
+   spin_unlock(&scd_netdev_lock);
+
+   if (!active || !*name)
+      return;
+
+   ndev = dev_get_by_name(&init_net, name);
+   if (!ndev) {
+      scd_led_set(led, LED_OFF);
+      return;
+   }
+   scd_led_set(led, scd_netdev_led_color(ndev, link_color));
+   dev_put(ndev);
+}
+
+static bool scd_led_is_scd(struct led_classdev *led_cdev)
+{
+   return led_cdev->brightness_set == led_brightness_set;
+}
+
+static void scd_netdev_trigger_set(struct led_classdev *led_cdev, bool active)
+{
+   struct scd_led *led = container_of(led_cdev, struct scd_led, cdev);
+
+   spin_lock(&scd_netdev_lock);
+   led->netdev_active = active;
+   spin_unlock(&scd_netdev_lock);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+static int scd_netdev_trigger_activate(struct led_classdev *led_cdev)
+{
+   if (!scd_led_is_scd(led_cdev))
+      return -EINVAL;
+   scd_netdev_trigger_set(led_cdev, true);
+   scd_led_netdev_refresh(container_of(led_cdev, struct scd_led, cdev));
+   return 0;
 }
+#else
+static void scd_netdev_trigger_activate(struct led_classdev *led_cdev)
+{
+   if (!scd_led_is_scd(led_cdev))
+      return;
+   scd_netdev_trigger_set(led_cdev, true);
+   scd_led_netdev_refresh(container_of(led_cdev, struct scd_led, cdev));
+}
+#endif
+
+static void scd_netdev_trigger_deactivate(struct led_classdev *led_cdev)
+{
+   if (scd_led_is_scd(led_cdev))
+      scd_netdev_trigger_set(led_cdev, false);
+}
+
+static struct led_trigger scd_netdev_trigger = {
+   .name = "scd-netdev",
+   .activate = scd_netdev_trigger_activate,
+   .deactivate = scd_netdev_trigger_deactivate,
+};
 
 static void scd_led_remove_all(struct scd_context *ctx)
 {
@@ -731,6 +1029,32 @@ static void scd_led_remove_all(struct scd_context *ctx)
       list_del(&led->list);
       kfree(led);
    }
+
+   kfree(ctx->leds);
+   ctx->leds = NULL;
+   ctx->led_count = 0;
+   ctx->led_table_size = 0;
+}
+
+static int scd_led_table_grow(struct scd_context *ctx)
+{
+   struct scd_led **leds;
+   size_t size;
+
+   if (ctx->led_count < ctx->led_table_size)
+      return 0;
+
+   if (ctx->led_count >= U16_MAX)
+      return -ENOSPC;
+
+   size = ctx->led_table_size ? ctx->led_table_size * 2 : 64;
+   leds = krealloc(ctx->leds, size * sizeof(*leds), GFP_KERNEL);
+   if (!leds)
+      return -ENOMEM;
+
+   ctx->leds = leds;
+   ctx->led_table_size = size;
+   return 0;
 }
 
 static struct scd_led *scd_led_find(struct scd_context *ctx, u32 addr)
@@ -752,6 +1076,10 @@ static int scd_led_add(struct scd_context *ctx, const char *name, u32 addr)
    if (scd_led_find(ctx, addr))
       return -EEXIST;
 
+   ret = scd_led_table_grow(ctx);
+   if (ret)
+      return ret;
+
    led = kzalloc(sizeof(*led), GFP_KERNEL);
    if (!led)
       return -ENOMEM;
@@ -763,6 +1091,11 @@ static int scd_led_add(struct scd_context *ctx, const char *name, u32 addr)
 
    led->cdev.name = led->name;
    led->cdev.brightness_set = led_brightness_set;
+   led->cdev.blink_set = led_blink_set;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+   led->cdev.pattern_set = led_pattern_set;
+   led->cdev.pattern_clear = led_pattern_clear;
+#endif
 
    ret = led_classdev_register(&ctx->pdev->dev, &led->cdev);
    if (ret) {
@@ -771,6 +1104,8 @@ static int scd_led_add(struct scd_context *ctx, const char *name, u32 addr)
    }
 
    list_add_tail(&led->list, &ctx->led_list);
+   led->index = ctx->led_count;
+   ctx->leds[ctx->led_count++] = led;
 
    return 0;
 }
@@ -779,8 +1114,15 @@ static ssize_t attribute_gpio_get(struct device *dev,
                                   struct device_attribute *devattr, char *buf)
 {
    const struct scd_gpio_attribute *gpio = to_scd_gpio_attr(devattr);
-   u32 reg = scd_read_register(gpio->ctx->pdev, gpio->addr);
-   u32 res = !!(reg & (1 << gpio->bit));
+   unsigned int reg;
+   u32 res;
+   int err;
+
+   err = regmap_read(gpio->ctx->regmap, gpio->addr, &reg);
+   if (err)
+      return err;
+
+   res = !!(reg & (1 << gpio->bit));
    res = (gpio->active_low) ? !res : res;
    return sprintf(buf, "%u\n", res);
 }
@@ -790,9 +1132,9 @@ static ssize_t attribute_gpio_set(struct device *dev,
                                   const char *buf, size_t count)
 {
    const struct scd_gpio_attribute *gpio = to_scd_gpio_attr(devattr);
+   u32 mask = 1 << gpio->bit;
    long value;
    int res;
-   u32 reg;
 
    res = kstrtol(buf, 10, &value);
    if (res < 0)
@@ -801,19 +1143,13 @@ static ssize_t attribute_gpio_set(struct device *dev,
    if (value != 0 && value != 1)
       return -EINVAL;
 
-   reg = scd_read_register(gpio->ctx->pdev, gpio->addr);
-   if (gpio->active_low) {
-      if (value)
-         reg &= ~(1 << gpio->bit);
-      else
-         reg |= ~(1 << gpio->bit);
-   } else {
-      if (value)
-         reg |= 1 << gpio->bit;
-      else
-         reg &= ~(1 << gpio->bit);
-   }
-   scd_write_register(gpio->ctx->pdev, gpio->addr, reg);
+   if (gpio->active_low)
+      value = !value;
+
+   res = regmap_update_bits(gpio->ctx->regmap, gpio->addr, mask,
+                            value ? mask : 0);
+   if (res)
+      return res;
 
    return count;
 }
@@ -851,8 +1187,15 @@ static ssize_t attribute_reset_get(struct device *dev,
                                    struct device_attribute *devattr, char *buf)
 {
    const struct scd_reset_attribute *reset = to_scd_reset_attr(devattr);
-   u32 reg = scd_read_register(reset->ctx->pdev, reset->addr);
-   u32 res = !!(reg & (1 << reset->bit));
+   unsigned int reg;
+   u32 res;
+   int err;
+
+   err = regmap_read(reset->ctx->regmap, reset->addr, &reg);
+   if (err)
+      return err;
+
+   res = !!(reg & (1 << reset->bit));
    return sprintf(buf, "%u\n", res);
 }
 
@@ -878,7 +1221,9 @@ static ssize_t attribute_reset_set(struct device *dev,
       offset = RESET_CLEAR_OFFSET;
 
    reg = 1 << reset->bit;
-   scd_write_register(reset->ctx->pdev, reset->addr + offset, reg);
+   res = regmap_write(reset->ctx->regmap, reset->addr + offset, reg);
+   if (res)
+      return res;
 
    return count;
 }
@@ -957,13 +1302,12 @@ static int scd_xcvr_add(struct scd_context *ctx, const char *prefix,
    return 0;
 
 fail:
-   if (gpio)
-      kfree(gpio);
-
+   // the failed gpio is already freed, undo the ones registered before it
    while (i--) {
       gpio = list_last_entry(&ctx->gpio_list, struct scd_gpio, list);
-      if (gpio)
-         list_del(&gpio->list);
+      scd_gpio_unregister(ctx, gpio);
+      list_del(&gpio->list);
+      kfree(gpio);
    }
 
    return err;
@@ -1361,88 +1705,670 @@ static ssize_t new_object(struct device *dev, struct device_attribute *attr,
 
 static DEVICE_ATTR(new_object, S_IRUGO|S_IWUSR|S_IWGRP, 0, new_object);
 
-static struct scd_bus *find_scd_bus(struct scd_context *ctx, u16 bus) {
-   struct scd_master *master;
-   struct scd_bus *scd_bus;
+static int scd_config_add_record(struct scd_context *ctx,
+                                 const struct scd_config_record *rec,
+                                 const char *name)
+{
+   u32 addr = le32_to_cpu(rec->addr);
+   u32 arg0 = le32_to_cpu(rec->arg0);
+   u32 arg1 = le32_to_cpu(rec->arg1);
+   u16 flags = le16_to_cpu(rec->flags);
 
-   list_for_each_entry(master, &ctx->master_list, list) {
-      list_for_each_entry(scd_bus, &master->bus_list, list) {
-         if (scd_bus->adap.nr != bus)
-            continue;
-         return scd_bus;
-      }
+   if (addr > ctx->res_size)
+      return -EINVAL;
+
+   switch (rec->type) {
+   case SCD_CONFIG_MASTER:
+      return scd_smbus_master_add(ctx, addr, arg0,
+                                  arg1 ? arg1 : MASTER_DEFAULT_BUS_COUNT);
+   case SCD_CONFIG_LED:
+      return scd_led_add(ctx, name, addr);
+   case SCD_CONFIG_QSFP:
+      return scd_xcvr_qsfp_add(ctx, addr, arg0);
+   case SCD_CONFIG_SFP:
+      return scd_xcvr_sfp_add(ctx, addr, arg0);
+   case SCD_CONFIG_RESET:
+      return scd_reset_add(ctx, name, addr, arg0);
+   case SCD_CONFIG_GPIO:
+      return scd_gpio_add(ctx, name, addr, arg0,
+                          !!(flags & SCD_CONFIG_GPIO_RO),
+                          !!(flags & SCD_CONFIG_GPIO_ACTIVE_LOW));
    }
-   return NULL;
+
+   return -EINVAL;
 }
 
-static ssize_t set_bus_params(struct scd_context *ctx, u16 bus,
-                              struct bus_params *params) {
-   struct bus_params *p;
-   struct scd_bus *scd_bus = find_scd_bus(ctx, bus);
+// last object of each list before a configuration is loaded
+struct scd_config_mark {
+   struct list_head *master;
+   struct list_head *led;
+   struct list_head *gpio;
+   struct list_head *reset;
+};
 
-   if (!scd_bus) {
-      scd_err("Cannot find bus %d to add tweak\n", bus);
-      return -EINVAL;
+static void scd_config_set_mark(struct scd_context *ctx,
+                                struct scd_config_mark *mark)
+{
+   mark->master = ctx->master_list.prev;
+   mark->led = ctx->led_list.prev;
+   mark->gpio = ctx->gpio_list.prev;
+   mark->reset = ctx->reset_list.prev;
+}
+
+// remove the objects created since the mark, newest first
+static void scd_config_rollback(struct scd_context *ctx,
+                                const struct scd_config_mark *mark)
+{
+   struct scd_master *master;
+   struct scd_reset *reset;
+   struct scd_gpio *gpio;
+   struct scd_led *led;
+
+   while (ctx->gpio_list.prev != mark->gpio) {
+      gpio = list_last_entry(&ctx->gpio_list, struct scd_gpio, list);
+      scd_gpio_unregister(ctx, gpio);
+      list_del(&gpio->list);
+      kfree(gpio);
    }
 
-   list_for_each_entry(p, &scd_bus->params, list) {
-      if (p->addr == params->addr) {
-         p->t = params->t;
-         p->datw = params->datw;
-         p->datr = params->datr;
-         return 0;
-      }
+   while (ctx->reset_list.prev != mark->reset) {
+      reset = list_last_entry(&ctx->reset_list, struct scd_reset, list);
+      scd_reset_unregister(ctx, reset);
+      list_del(&reset->list);
+      kfree(reset);
    }
 
-   p = kzalloc(sizeof(*p), GFP_KERNEL);
-   if (!p) {
-      return -ENOMEM;
+   // leds are appended to the index table in list order
+   while (ctx->led_list.prev != mark->led) {
+      led = list_last_entry(&ctx->led_list, struct scd_led, list);
+      led_classdev_unregister(&led->cdev);
+      list_del(&led->list);
+      ctx->leds[--ctx->led_count] = NULL;
+      kfree(led);
    }
 
-   p->addr = params->addr;
-   p->t = params->t;
-   p->datw = params->datw;
-   p->datr = params->datr;
-   list_add_tail(&p->list, &scd_bus->params);
-   return 0;
+   while (ctx->master_list.prev != mark->master) {
+      master = list_last_entry(&ctx->master_list, struct scd_master, list);
+      scd_smbus_master_remove(master);
+   }
 }
 
-static ssize_t parse_smbus_tweak(struct scd_context *ctx, const char *buf,
-                                 size_t count)
+/*
+ * Create every object described by a complete binary configuration.  It is all
+ * or nothing: on error the objects already created are removed again so that
+ * userspace can retry with the text configuration.
+ */
+static int scd_config_load(struct scd_context *ctx, const u8 *buf, size_t size)
 {
-   char buf_copy[MAX_CONFIG_LINE_SIZE];
-   struct bus_params params;
-   ssize_t err;
-   char *ptr = buf_copy;
-   const char *tmp;
-   u16 bus;
+   const struct scd_config_header *hdr = (const struct scd_config_header *)buf;
+   const struct scd_config_record *rec;
+   char name[MAX_CONFIG_LINE_SIZE];
+   struct scd_config_mark mark;
+   size_t offset = sizeof(*hdr);
+   u16 count = le16_to_cpu(hdr->count);
+   int err = 0;
+   u16 i;
 
-   if (count >= MAX_CONFIG_LINE_SIZE) {
-      scd_warn("smbus_tweak line is too long\n");
-      return -EINVAL;
-   }
+   scd_config_set_mark(ctx, &mark);
 
-   strncpy(buf_copy, buf, count);
-   buf_copy[count] = 0;
+   for (i = 0; i < count; i++) {
+      if (offset + sizeof(*rec) > size) {
+         err = -EINVAL;
+         goto fail;
+      }
+      rec = (const struct scd_config_record *)(buf + offset);
+      offset += sizeof(*rec);
 
-   PARSE_INT_OR_RETURN(&ptr, tmp, u16, &bus);
-   PARSE_INT_OR_RETURN(&ptr, tmp, u16, &params.addr);
-   PARSE_INT_OR_RETURN(&ptr, tmp, u8, &params.t);
-   PARSE_INT_OR_RETURN(&ptr, tmp, u8, &params.datr);
-   PARSE_INT_OR_RETURN(&ptr, tmp, u8, &params.datw);
+      if (offset + rec->name_len > size || rec->name_len >= sizeof(name)) {
+         err = -EINVAL;
+         goto fail;
+      }
+      memcpy(name, buf + offset, rec->name_len);
+      name[rec->name_len] = 0;
+      offset += rec->name_len;
 
-   err = set_bus_params(ctx, bus, &params);
-   if (err == 0)
-      return count;
+      err = scd_config_add_record(ctx, rec, name);
+      if (err) {
+         scd_err("failed to create object %u of type %u (%d)\n", i, rec->type,
+                 err);
+         goto fail;
+      }
+   }
+
+   return 0;
+
+fail:
+   scd_config_rollback(ctx, &mark);
    return err;
 }
 
-static ssize_t smbus_tweaks(struct device *dev, struct device_attribute *attr,
-                            const char *buf, size_t count)
+static void scd_config_reset(struct scd_context *ctx)
 {
-   ssize_t res;
-   struct scd_context *ctx = get_context_for_dev(dev);
-
+   if (ctx->config) {
+      vfree(ctx->config);
+      ctx->config = NULL;
+   }
+   ctx->config_len = 0;
+   ctx->config_size = 0;
+}
+
+/*
+ * The configuration can be larger than what sysfs hands us in one call, the
+ * chunks are accumulated until the size given in the header is reached and the
+ * whole configuration is then applied at once.
+ */
+static ssize_t new_object_bin_write(struct file *filp, struct kobject *kobj,
+                                    struct bin_attribute *attr, char *buf,
+                                    loff_t off, size_t count)
+{
+   struct device *dev = container_of(kobj, struct device, kobj);
+   struct scd_context *ctx = get_context_for_dev(dev);
+   const struct scd_config_header *hdr;
+   size_t size;
+   ssize_t res = count;
+   int err;
+
+   if (!ctx) {
+      return -ENODEV;
+   }
+
+   scd_lock(ctx);
+   if (ctx->initialized) {
+      res = -EBUSY;
+      goto out;
+   }
+
+   if (off == 0) {
+      scd_config_reset(ctx);
+      if (count < sizeof(*hdr)) {
+         res = -EINVAL;
+         goto out;
+      }
+      hdr = (const struct scd_config_header *)buf;
+      size = le32_to_cpu(hdr->size);
+      if (le32_to_cpu(hdr->magic) != SCD_CONFIG_MAGIC ||
+          le16_to_cpu(hdr->version) != SCD_CONFIG_VERSION ||
+          size < sizeof(*hdr) || size > SCD_CONFIG_MAX_SIZE) {
+         scd_warn("invalid binary configuration header\n");
+         res = -EINVAL;
+         goto out;
+      }
+      ctx->config = vmalloc(size);
+      if (!ctx->config) {
+         res = -ENOMEM;
+         goto out;
+      }
+      ctx->config_size = size;
+   } else if (!ctx->config || off != ctx->config_len) {
+      res = -EINVAL;
+      goto out;
+   }
+
+   if (ctx->config_len + count > ctx->config_size) {
+      res = -EFBIG;
+      goto fail;
+   }
+
+   memcpy(ctx->config + ctx->config_len, buf, count);
+   ctx->config_len += count;
+
+   if (ctx->config_len == ctx->config_size) {
+      err = scd_config_load(ctx, ctx->config, ctx->config_size);
+      scd_config_reset(ctx);
+      if (err) {
+         res = err;
+      }
+   }
+   goto out;
+
+fail:
+   scd_config_reset(ctx);
+out:
+   scd_unlock(ctx);
+   return res;
+}
+
+static struct bin_attribute new_object_bin_attr = {
+   .attr = {
+      .name = "new_object_bin",
+      .mode = S_IWUSR|S_IWGRP,
+   },
+   .size = SCD_CONFIG_MAX_SIZE,
+   .write = new_object_bin_write,
+};
+
+/*
+ * The led bank attributes drive every led of the scd with a single write:
+ *  - led_names lists the leds, one name per line, in index order
+ *  - led_bank takes struct scd_led_bank_entry records, for sparse updates
+ *  - led_colors is the packed array of the colors of all the leds, one byte per
+ *    led, writing at an offset updates the leds starting at that index
+ */
+static ssize_t led_names_read(struct file *filp, struct kobject *kobj,
+                              struct bin_attribute *attr, char *buf,
+                              loff_t off, size_t count)
+{
+   struct device *dev = container_of(kobj, struct device, kobj);
+   struct scd_context *ctx = get_context_for_dev(dev);
+   size_t size = 0;
+   ssize_t res;
+   char *names;
+   size_t i;
+
+   if (!ctx) {
+      return -ENODEV;
+   }
+
+   scd_lock(ctx);
+   names = kmalloc(ctx->led_count * (LED_NAME_MAX_SZ + 1), GFP_KERNEL);
+   if (!names) {
+      res = -ENOMEM;
+      goto out;
+   }
+
+   for (i = 0; i < ctx->led_count; i++) {
+      size += sprintf(names + size, "%.*s\n", LED_NAME_MAX_SZ,
+                      ctx->leds[i]->name);
+   }
+
+   res = 0;
+   if (off < size) {
+      res = min_t(size_t, count, size - off);
+      memcpy(buf, names + off, res);
+   }
+   kfree(names);
+
+out:
+   scd_unlock(ctx);
+   return res;
+}
+
+static ssize_t led_bank_write(struct file *filp, struct kobject *kobj,
+                              struct bin_attribute *attr, char *buf,
+                              loff_t off, size_t count)
+{
+   struct device *dev = container_of(kobj, struct device, kobj);
+   struct scd_context *ctx = get_context_for_dev(dev);
+   const struct scd_led_bank_entry *entry;
+   size_t entries = count / sizeof(*entry);
+   ssize_t res = count;
+   size_t i;
+   u16 index;
+
+   if (!ctx) {
+      return -ENODEV;
+   }
+
+   // large writes are split by sysfs, records are independent from each other
+   if (off % sizeof(*entry) || count % sizeof(*entry)) {
+      return -EINVAL;
+   }
+
+   scd_lock(ctx);
+   entry = (const struct scd_led_bank_entry *)buf;
+   for (i = 0; i < entries; i++) {
+      if (le16_to_cpu(entry[i].index) >= ctx->led_count) {
+         res = -EINVAL;
+         goto out;
+      }
+   }
+
+   for (i = 0; i < entries; i++) {
+      index = le16_to_cpu(entry[i].index);
+      scd_led_set(ctx->leds[index], entry[i].color);
+   }
+
+out:
+   scd_unlock(ctx);
+   return res;
+}
+
+static ssize_t led_colors_read(struct file *filp, struct kobject *kobj,
+                               struct bin_attribute *attr, char *buf,
+                               loff_t off, size_t count)
+{
+   struct device *dev = container_of(kobj, struct device, kobj);
+   struct scd_context *ctx = get_context_for_dev(dev);
+   size_t i;
+
+   if (!ctx) {
+      return -ENODEV;
+   }
+
+   scd_lock(ctx);
+   if (off >= ctx->led_count) {
+      count = 0;
+   } else {
+      count = min_t(size_t, count, ctx->led_count - off);
+   }
+   for (i = 0; i < count; i++) {
+      buf[i] = ctx->leds[off + i]->cdev.brightness;
+   }
+   scd_unlock(ctx);
+
+   return count;
+}
+
+static ssize_t led_colors_write(struct file *filp, struct kobject *kobj,
+                                struct bin_attribute *attr, char *buf,
+                                loff_t off, size_t count)
+{
+   struct device *dev = container_of(kobj, struct device, kobj);
+   struct scd_context *ctx = get_context_for_dev(dev);
+   ssize_t res = count;
+   size_t i;
+
+   if (!ctx) {
+      return -ENODEV;
+   }
+
+   scd_lock(ctx);
+   if (off + count > ctx->led_count) {
+      res = -EINVAL;
+      goto out;
+   }
+   for (i = 0; i < count; i++) {
+      scd_led_set(ctx->leds[off + i], buf[i]);
+   }
+
+out:
+   scd_unlock(ctx);
+   return res;
+}
+
+static struct bin_attribute led_names_attr = {
+   .attr = {
+      .name = "led_names",
+      .mode = S_IRUGO,
+   },
+   .size = 0,
+   .read = led_names_read,
+};
+
+static struct bin_attribute led_bank_attr = {
+   .attr = {
+      .name = "led_bank",
+      .mode = S_IWUSR|S_IWGRP,
+   },
+   .size = U16_MAX * sizeof(struct scd_led_bank_entry),
+   .write = led_bank_write,
+};
+
+static struct bin_attribute led_colors_attr = {
+   .attr = {
+      .name = "led_colors",
+      .mode = S_IRUGO|S_IWUSR|S_IWGRP,
+   },
+   .size = U16_MAX,
+   .read = led_colors_read,
+   .write = led_colors_write,
+};
+
+static struct bin_attribute *led_bank_attrs[] = {
+   &led_names_attr,
+   &led_bank_attr,
+   &led_colors_attr,
+};
+
+static void scd_led_bank_remove(struct pci_dev *pdev)
+{
+   int i;
+
+   for (i = 0; i < ARRAY_SIZE(led_bank_attrs); i++) {
+      sysfs_remove_bin_file(&pdev->dev.kobj, led_bank_attrs[i]);
+   }
+}
+
+static int scd_led_bank_create(struct pci_dev *pdev)
+{
+   int err;
+   int i;
+
+   for (i = 0; i < ARRAY_SIZE(led_bank_attrs); i++) {
+      err = sysfs_create_bin_file(&pdev->dev.kobj, led_bank_attrs[i]);
+      if (err) {
+         while (--i >= 0) {
+            sysfs_remove_bin_file(&pdev->dev.kobj, led_bank_attrs[i]);
+         }
+         return err;
+      }
+   }
+
+   return 0;
+}
+
+static int scd_netdev_event(struct notifier_block *nb, unsigned long event,
+                            void *ptr)
+{
+   struct net_device *ndev = netdev_notifier_info_to_dev(ptr);
+   struct scd_context *ctx;
+   struct scd_led *led;
+   bool match;
+   u8 color;
+
+   switch (event) {
+   case NETDEV_UP:
+   case NETDEV_DOWN:
+   case NETDEV_CHANGE:
+   case NETDEV_REGISTER:
+   case NETDEV_UNREGISTER:
+   case NETDEV_CHANGENAME:
+      break;
+   default:
+      return NOTIFY_DONE;
+   }
+
+   if (!net_eq(dev_net(ndev), &init_net))
+      return NOTIFY_DONE;
+
+   module_lock();
+   list_for_each_entry(ctx, &scd_list, list) {
+      scd_lock(ctx);
+      list_for_each_entry(led, &ctx->led_list, list) {
+         // a renamed netdev is looked up again by name
+         if (event == NETDEV_CHANGENAME) {
+            scd_led_netdev_refresh(led);
+            continue;
+         }
+
+         spin_lock(&scd_netdev_lock);
+         match = led->netdev_active && !strcmp(led->netdev, ndev->name);
+         color = scd_netdev_led_color(ndev, led->link_color);
+         spin_unlock(&scd_netdev_lock);
+
+         if (!match)
+            continue;
+         scd_led_set(led, event == NETDEV_UNREGISTER ? LED_OFF : color);
+      }
+      scd_unlock(ctx);
+   }
+   module_unlock();
+
+   return NOTIFY_DONE;
+}
+
+static struct notifier_block scd_netdev_notifier = {
+   .notifier_call = scd_netdev_event,
+};
+
+// <led> <ifname> [<link_color>], binds a led to a netdev, "-" unbinds it
+static ssize_t parse_led_netdev(struct scd_context *ctx, const char *buf,
+                                size_t count)
+{
+   char tmp[MAX_CONFIG_LINE_SIZE];
+   char *ptr = tmp;
+   const char *name;
+   const char *ifname;
+   struct scd_led *led;
+   u8 link_color = SCD_LED_LINK_COLOR_DEFAULT;
+   const char *tok;
+   int res;
+
+   if (count >= MAX_CONFIG_LINE_SIZE)
+      return -EINVAL;
+
+   strncpy(tmp, buf, count);
+   tmp[count] = 0;
+
+   PARSE_STR_OR_RETURN(&ptr, tok, name);
+   PARSE_STR_OR_RETURN(&ptr, tok, ifname);
+   tok = strsep(&ptr, " ");
+   if (tok && *tok) {
+      res = kstrtou8(tok, 0, &link_color);
+      if (res)
+         return res;
+      PARSE_END_OR_RETURN(&ptr, tok);
+   }
+
+   if (strlen(ifname) >= IFNAMSIZ)
+      return -EINVAL;
+
+   list_for_each_entry(led, &ctx->led_list, list) {
+      if (strncmp(led->name, name, LED_NAME_MAX_SZ))
+         continue;
+
+      spin_lock(&scd_netdev_lock);
+      if (!strcmp(ifname, "-"))
+         led->netdev[0] = '\0';
+      else
+         strcpy(led->netdev, ifname);
+      led->link_color = link_color;
+      spin_unlock(&scd_netdev_lock);
+
+      scd_led_netdev_refresh(led);
+      return count;
+   }
+
+   return -ENOENT;
+}
+
+static ssize_t led_netdev_show(struct device *dev, struct device_attribute *attr,
+                               char *buf)
+{
+   struct scd_context *ctx = get_context_for_dev(dev);
+   struct scd_led *led;
+   ssize_t size = 0;
+
+   if (!ctx) {
+      return -ENODEV;
+   }
+
+   scd_lock(ctx);
+   spin_lock(&scd_netdev_lock);
+   list_for_each_entry(led, &ctx->led_list, list) {
+      if (!*led->netdev)
+         continue;
+      size += scnprintf(buf + size, PAGE_SIZE - size, "%.*s %s %u\n",
+                        LED_NAME_MAX_SZ, led->name, led->netdev,
+                        led->link_color);
+   }
+   spin_unlock(&scd_netdev_lock);
+   scd_unlock(ctx);
+
+   return size;
+}
+
+static ssize_t led_netdev_store(struct device *dev, struct device_attribute *attr,
+                                const char *buf, size_t count)
+{
+   struct scd_context *ctx = get_context_for_dev(dev);
+   ssize_t res;
+
+   if (!ctx) {
+      return -ENODEV;
+   }
+
+   scd_lock(ctx);
+   res = parse_lines(ctx, buf, count, parse_led_netdev);
+   scd_unlock(ctx);
+   return res;
+}
+
+static DEVICE_ATTR(led_netdev, S_IRUGO|S_IWUSR|S_IWGRP, led_netdev_show,
+                   led_netdev_store);
+
+static struct scd_bus *find_scd_bus(struct scd_context *ctx, u16 bus) {
+   struct scd_master *master;
+   struct scd_bus *scd_bus;
+
+   list_for_each_entry(master, &ctx->master_list, list) {
+      list_for_each_entry(scd_bus, &master->bus_list, list) {
+         if (scd_bus->adap.nr != bus)
+            continue;
+         return scd_bus;
+      }
+   }
+   return NULL;
+}
+
+static ssize_t set_bus_params(struct scd_context *ctx, u16 bus,
+                              struct bus_params *params) {
+   struct bus_params *p;
+   struct scd_bus *scd_bus = find_scd_bus(ctx, bus);
+
+   if (!scd_bus) {
+      scd_err("Cannot find bus %d to add tweak\n", bus);
+      return -EINVAL;
+   }
+
+   list_for_each_entry(p, &scd_bus->params, list) {
+      if (p->addr == params->addr) {
+         p->t = params->t;
+         p->datw = params->datw;
+         p->datr = params->datr;
+         return 0;
+      }
+   }
+
+   p = kzalloc(sizeof(*p), GFP_KERNEL);
+   if (!p) {
+      return -ENOMEM;
+   }
+
+   p->addr = params->addr;
+   p->t = params->t;
+   p->datw = params->datw;
+   p->datr = params->datr;
+   list_add_tail(&p->list, &scd_bus->params);
+   return 0;
+}
+
+static ssize_t parse_smbus_tweak(struct scd_context *ctx, const char *buf,
+                                 size_t count)
+{
+   char buf_copy[MAX_CONFIG_LINE_SIZE];
+   struct bus_params params;
+   ssize_t err;
+   char *ptr = buf_copy;
+   const char *tmp;
+   u16 bus;
+
+   if (count >= MAX_CONFIG_LINE_SIZE) {
+      scd_warn("smbus_tweak line is too long\n");
+      return -EINVAL;
+   }
+
+   strncpy(buf_copy, buf, count);
+   buf_copy[count] = 0;
+
+   PARSE_INT_OR_RETURN(&ptr, tmp, u16, &bus);
+   PARSE_INT_OR_RETURN(&ptr, tmp, u16, &params.addr);
+   PARSE_INT_OR_RETURN(&ptr, tmp, u8, &params.t);
+   PARSE_INT_OR_RETURN(&ptr, tmp, u8, &params.datr);
+   PARSE_INT_OR_RETURN(&ptr, tmp, u8, &params.datw);
+
+   err = set_bus_params(ctx, bus, &params);
+   if (err == 0)
+      return count;
+   return err;
+}
+
+static ssize_t smbus_tweaks(struct device *dev, struct device_attribute *attr,
+                            const char *buf, size_t count)
+{
+   ssize_t res;
+   struct scd_context *ctx = get_context_for_dev(dev);
+
    if (!ctx) {
       return -ENODEV;
    }
@@ -1455,6 +2381,144 @@ static ssize_t smbus_tweaks(struct device *dev, struct device_attribute *attr,
 
 static DEVICE_ATTR(smbus_tweaks, S_IRUGO|S_IWUSR|S_IWGRP, 0, smbus_tweaks);
 
+static struct scd_master *find_scd_master(struct scd_context *ctx, u32 id)
+{
+   struct scd_master *master;
+
+   list_for_each_entry(master, &ctx->master_list, list) {
+      if (master->id == id)
+         return master;
+   }
+   return NULL;
+}
+
+/*
+ * Give a master to userspace or take it back.
+ * Taking the master lock waits for the transaction in flight, if any, after that
+ * the kernel refuses transactions on this master with -EBUSY until it is given
+ * back.  The master belongs to the process writing "user" and is given back
+ * automatically once that process exits, so a crash can't leave the kernel
+ * adapters locked out.  The master is reset when the kernel takes it back since
+ * userspace may have left it in any state.
+ */
+static ssize_t parse_smbus_master_owner(struct scd_context *ctx, const char *buf,
+                                        size_t count)
+{
+   char buf_copy[MAX_CONFIG_LINE_SIZE];
+   struct scd_master *master;
+   char *ptr = buf_copy;
+   const char *tmp;
+   const char *owner;
+   bool user_owned;
+   u32 id;
+
+   if (count >= MAX_CONFIG_LINE_SIZE) {
+      scd_warn("smbus_master_owner line is too long\n");
+      return -EINVAL;
+   }
+
+   strncpy(buf_copy, buf, count);
+   buf_copy[count] = 0;
+
+   PARSE_INT_OR_RETURN(&ptr, tmp, u32, &id);
+   PARSE_STR_OR_RETURN(&ptr, tmp, owner);
+   PARSE_END_OR_RETURN(&ptr, tmp);
+
+   if (!strcmp(owner, "user")) {
+      user_owned = true;
+   } else if (!strcmp(owner, "kernel")) {
+      user_owned = false;
+   } else {
+      return -EINVAL;
+   }
+
+   master = find_scd_master(ctx, id);
+   if (!master) {
+      scd_err("Cannot find master %u to change owner\n", id);
+      return -EINVAL;
+   }
+
+   master_lock(master);
+   smbus_master_set_owner(master, user_owned);
+   master_unlock(master);
+
+   return count;
+}
+
+static ssize_t smbus_master_owner_show(struct device *dev,
+                                       struct device_attribute *attr, char *buf)
+{
+   struct scd_context *ctx = get_context_for_dev(dev);
+   struct scd_master *master;
+   ssize_t len = 0;
+
+   if (!ctx) {
+      return -ENODEV;
+   }
+
+   scd_lock(ctx);
+   list_for_each_entry(master, &ctx->master_list, list) {
+      master_lock(master);
+      smbus_master_check_owner(master);
+      if (master->user_owned) {
+         len += scnprintf(buf + len, PAGE_SIZE - len, "%u user %d\n", master->id,
+                          pid_nr(master->owner));
+      } else {
+         len += scnprintf(buf + len, PAGE_SIZE - len, "%u kernel\n", master->id);
+      }
+      master_unlock(master);
+   }
+   scd_unlock(ctx);
+
+   return len;
+}
+
+static ssize_t smbus_master_owner_store(struct device *dev,
+                                        struct device_attribute *attr,
+                                        const char *buf, size_t count)
+{
+   ssize_t res;
+   struct scd_context *ctx = get_context_for_dev(dev);
+
+   if (!ctx) {
+      return -ENODEV;
+   }
+
+   scd_lock(ctx);
+   res = parse_lines(ctx, buf, count, parse_smbus_master_owner);
+   scd_unlock(ctx);
+   return res;
+}
+
+// 1 once every smbus master is ready for transactions
+static ssize_t smbus_ready_show(struct device *dev, struct device_attribute *attr,
+                                char *buf)
+{
+   struct scd_context *ctx = get_context_for_dev(dev);
+   struct scd_master *master;
+   bool ready = true;
+
+   if (!ctx) {
+      return -ENODEV;
+   }
+
+   scd_lock(ctx);
+   list_for_each_entry(master, &ctx->master_list, list) {
+      if (!completion_done(&master->ready)) {
+         ready = false;
+         break;
+      }
+   }
+   scd_unlock(ctx);
+
+   return sprintf(buf, "%d\n", ready);
+}
+
+static DEVICE_ATTR(smbus_ready, S_IRUGO, smbus_ready_show, NULL);
+
+static DEVICE_ATTR(smbus_master_owner, S_IRUGO|S_IWUSR|S_IWGRP,
+                   smbus_master_owner_show, smbus_master_owner_store);
+
 static int scd_ext_hwmon_probe(struct pci_dev *pdev)
 {
    struct scd_context *ctx = get_context_for_pdev(pdev);
@@ -1465,6 +2529,11 @@ static int scd_ext_hwmon_probe(struct pci_dev *pdev)
       return -EEXIST;
    }
 
+   if (!scd_get_regmap(pdev)) {
+      scd_warn("no regmap for this pci device\n");
+      return -ENODEV;
+   }
+
    ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
    if (!ctx) {
       return -ENOMEM;
@@ -1478,6 +2547,7 @@ static int scd_ext_hwmon_probe(struct pci_dev *pdev)
    mutex_init(&ctx->mutex);
 
    ctx->res_size = scd_resource_len(pdev);
+   ctx->regmap = scd_get_regmap(pdev);
 
    INIT_LIST_HEAD(&ctx->led_list);
    INIT_LIST_HEAD(&ctx->master_list);
@@ -1496,6 +2566,51 @@ static int scd_ext_hwmon_probe(struct pci_dev *pdev)
       goto fail_sysfs;
    }
 
+   err = sysfs_create_file(&pdev->dev.kobj, &dev_attr_smbus_master_owner.attr);
+   if (err) {
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_tweaks.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_new_object.attr);
+      goto fail_sysfs;
+   }
+
+   err = sysfs_create_file(&pdev->dev.kobj, &dev_attr_smbus_ready.attr);
+   if (err) {
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_master_owner.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_tweaks.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_new_object.attr);
+      goto fail_sysfs;
+   }
+
+   err = sysfs_create_bin_file(&pdev->dev.kobj, &new_object_bin_attr);
+   if (err) {
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_ready.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_master_owner.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_tweaks.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_new_object.attr);
+      goto fail_sysfs;
+   }
+
+   err = scd_led_bank_create(pdev);
+   if (err) {
+      sysfs_remove_bin_file(&pdev->dev.kobj, &new_object_bin_attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_ready.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_master_owner.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_tweaks.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_new_object.attr);
+      goto fail_sysfs;
+   }
+
+   err = sysfs_create_file(&pdev->dev.kobj, &dev_attr_led_netdev.attr);
+   if (err) {
+      scd_led_bank_remove(pdev);
+      sysfs_remove_bin_file(&pdev->dev.kobj, &new_object_bin_attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_ready.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_master_owner.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_tweaks.attr);
+      sysfs_remove_file(&pdev->dev.kobj, &dev_attr_new_object.attr);
+      goto fail_sysfs;
+   }
+
    module_lock();
    list_add_tail(&ctx->list, &scd_list);
    module_unlock();
@@ -1533,7 +2648,13 @@ static void scd_ext_hwmon_remove(struct pci_dev *pdev)
 
    sysfs_remove_file(&pdev->dev.kobj, &dev_attr_new_object.attr);
    sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_tweaks.attr);
+   sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_master_owner.attr);
+   sysfs_remove_file(&pdev->dev.kobj, &dev_attr_smbus_ready.attr);
+   sysfs_remove_bin_file(&pdev->dev.kobj, &new_object_bin_attr);
+   scd_led_bank_remove(pdev);
+   sysfs_remove_file(&pdev->dev.kobj, &dev_attr_led_netdev.attr);
 
+   scd_config_reset(ctx);
    kfree(ctx);
 
    kobject_put(&pdev->dev.kobj);
@@ -1568,19 +2689,39 @@ static int __init scd_hwmon_init(void)
    mutex_init(&scd_hwmon_mutex);
    INIT_LIST_HEAD(&scd_list);
 
+   err = led_trigger_register(&scd_netdev_trigger);
+   if (err) {
+      scd_warn("failed to register the scd-netdev led trigger\n");
+      return err;
+   }
+
+   err = register_netdevice_notifier(&scd_netdev_notifier);
+   if (err) {
+      scd_warn("register_netdevice_notifier failed\n");
+      goto fail_notifier;
+   }
+
    err = scd_register_ext_ops(&scd_hwmon_ops);
    if (err) {
       scd_warn("scd_register_ext_ops failed\n");
-      return err;
+      goto fail_ext_ops;
    }
 
    return err;
+
+fail_ext_ops:
+   unregister_netdevice_notifier(&scd_netdev_notifier);
+fail_notifier:
+   led_trigger_unregister(&scd_netdev_trigger);
+   return err;
 }
 
 static void __exit scd_hwmon_exit(void)
 {
    scd_info("unloading scd hwmon driver\n");
    scd_unregister_ext_ops();
+   unregister_netdevice_notifier(&scd_netdev_notifier);
+   led_trigger_unregister(&scd_netdev_trigger);
 }
 
 module_init(scd_hwmon_init);
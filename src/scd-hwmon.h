@@ -12,4 +12,60 @@
 #define scd_dbg(fmt, ...) \
    pr_debug("scd-hwmon: " fmt, ##__VA_ARGS__);
 
+/*
+ * Binary layout accepted by the new_object_bin attribute, all fields are little
+ * endian.  A header is followed by hdr.count records, each record is followed by
+ * name_len bytes of name (not nul terminated).  The same objects as the text
+ * new_object lines are described:
+ *
+ *   master  addr, arg0 = id, arg1 = bus count
+ *   led     addr, name
+ *   qsfp    addr, arg0 = id
+ *   sfp     addr, arg0 = id
+ *   reset   addr, arg0 = bit, name
+ *   gpio    addr, arg0 = bit, flags, name
+ */
+#define SCD_CONFIG_MAGIC 0x43444353 // "SCDC"
+#define SCD_CONFIG_VERSION 1
+#define SCD_CONFIG_MAX_SIZE (1 << 20)
+
+enum scd_config_type {
+   SCD_CONFIG_MASTER = 1,
+   SCD_CONFIG_LED = 2,
+   SCD_CONFIG_QSFP = 3,
+   SCD_CONFIG_SFP = 4,
+   SCD_CONFIG_RESET = 5,
+   SCD_CONFIG_GPIO = 6,
+};
+
+#define SCD_CONFIG_GPIO_RO         (1 << 0)
+#define SCD_CONFIG_GPIO_ACTIVE_LOW (1 << 1)
+
+struct scd_config_header {
+   __le32 magic;
+   __le16 version;
+   __le16 count;
+   __le32 size; // whole blob, header included
+} __packed;
+
+struct scd_config_record {
+   u8 type;
+   u8 name_len;
+   __le16 flags;
+   __le32 addr;
+   __le32 arg0;
+   __le32 arg1;
+} __packed;
+
+/*
+ * Records written to the led_bank attribute, little endian.  index is the
+ * position of the led in led_names (the order the leds were created in) and
+ * color one of the brightness values of the led class device.
+ */
+struct scd_led_bank_entry {
+   __le16 index;
+   u8 color;
+   u8 reserved;
+} __packed;
+
 #endif /* !_LINUX_DRIVER_SCD_HWMON_H_ */
@@ -0,0 +1,127 @@
+/* Copyright (c) 2017 Arista Networks, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// tracepoints of the scd driver, see /sys/kernel/debug/tracing/events/scd
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM scd
+
+#if !defined(_SCD_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _SCD_TRACE_H_
+
+#include <linux/pci.h>
+#include <linux/tracepoint.h>
+
+#define scd_trace_pci_id(pdev) (((pdev)->bus->number << 8) | (pdev)->devfn)
+
+DECLARE_EVENT_CLASS(scd_reg,
+   TP_PROTO(struct pci_dev *pdev, u32 offset, u32 val),
+   TP_ARGS(pdev, offset, val),
+   TP_STRUCT__entry(
+      __field(u32, pci_id)
+      __field(u32, offset)
+      __field(u32, val)
+   ),
+   TP_fast_assign(
+      __entry->pci_id = scd_trace_pci_id(pdev);
+      __entry->offset = offset;
+      __entry->val = val;
+   ),
+   TP_printk("scd=%02x:%02x.%d offset=0x%04x val=0x%08x",
+             __entry->pci_id >> 8, (__entry->pci_id >> 3) & 0x1f,
+             __entry->pci_id & 0x7, __entry->offset, __entry->val)
+);
+
+DEFINE_EVENT(scd_reg, scd_reg_read,
+   TP_PROTO(struct pci_dev *pdev, u32 offset, u32 val),
+   TP_ARGS(pdev, offset, val)
+);
+
+DEFINE_EVENT(scd_reg, scd_reg_write,
+   TP_PROTO(struct pci_dev *pdev, u32 offset, u32 val),
+   TP_ARGS(pdev, offset, val)
+);
+
+// hard irq handling of one interrupt register
+TRACE_EVENT(scd_irq_entry,
+   TP_PROTO(struct pci_dev *pdev, u32 irq_reg, u32 status, u32 mask),
+   TP_ARGS(pdev, irq_reg, status, mask),
+   TP_STRUCT__entry(
+      __field(u32, pci_id)
+      __field(u32, irq_reg)
+      __field(u32, status)
+      __field(u32, mask)
+   ),
+   TP_fast_assign(
+      __entry->pci_id = scd_trace_pci_id(pdev);
+      __entry->irq_reg = irq_reg;
+      __entry->status = status;
+      __entry->mask = mask;
+   ),
+   TP_printk("scd=%02x:%02x.%d reg=%u status=0x%08x mask=0x%08x",
+             __entry->pci_id >> 8, (__entry->pci_id >> 3) & 0x1f,
+             __entry->pci_id & 0x7, __entry->irq_reg, __entry->status,
+             __entry->mask)
+);
+
+TRACE_EVENT(scd_irq_exit,
+   TP_PROTO(struct pci_dev *pdev, u32 irq_reg, u32 pending),
+   TP_ARGS(pdev, irq_reg, pending),
+   TP_STRUCT__entry(
+      __field(u32, pci_id)
+      __field(u32, irq_reg)
+      __field(u32, pending)
+   ),
+   TP_fast_assign(
+      __entry->pci_id = scd_trace_pci_id(pdev);
+      __entry->irq_reg = irq_reg;
+      __entry->pending = pending;
+   ),
+   TP_printk("scd=%02x:%02x.%d reg=%u pending=0x%08x",
+             __entry->pci_id >> 8, (__entry->pci_id >> 3) & 0x1f,
+             __entry->pci_id & 0x7, __entry->irq_reg, __entry->pending)
+);
+
+// threaded dispatch of the bits masked by the hard irq handler
+TRACE_EVENT(scd_irq_dispatch,
+   TP_PROTO(struct pci_dev *pdev, u32 irq_reg, u32 pending, u32 unexpected),
+   TP_ARGS(pdev, irq_reg, pending, unexpected),
+   TP_STRUCT__entry(
+      __field(u32, pci_id)
+      __field(u32, irq_reg)
+      __field(u32, pending)
+      __field(u32, unexpected)
+   ),
+   TP_fast_assign(
+      __entry->pci_id = scd_trace_pci_id(pdev);
+      __entry->irq_reg = irq_reg;
+      __entry->pending = pending;
+      __entry->unexpected = unexpected;
+   ),
+   TP_printk("scd=%02x:%02x.%d reg=%u pending=0x%08x unexpected=0x%08x",
+             __entry->pci_id >> 8, (__entry->pci_id >> 3) & 0x1f,
+             __entry->pci_id & 0x7, __entry->irq_reg, __entry->pending,
+             __entry->unexpected)
+);
+
+#endif /* _SCD_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE scd-trace
+#include <trace/define_trace.h>
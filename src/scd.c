@@ -31,6 +31,7 @@
  *   interrupt_mask
  *   interrupt_mask_powerloss
  *   interrupt_mask_ardma
+ *   interrupt_affinity
  *   crc_error_irq
  *   crc_error_panic
  *   ptp_high_offset
@@ -40,6 +41,7 @@
  *   power_loss
  *   ardma_offset
  *   interrupt_poll
+ *   msix
  *   nmi_port_io_p
  *   nmi_control_reg_addr
  *   nmi_control_mask
@@ -61,6 +63,12 @@
  * the PCI interrupt, then write the interrupt_irq file. To raise a kernel panic
  * upon a crc interrupt, set crc_error_panic to 1.
  *
+ * Writing 1 to msix makes the driver use one MSI-X vector per configured interrupt
+ * register instead of a single shared line, vector N serving interrupt register N.
+ * Each vector only scans its own register.  interrupt_affinity<N> is a mask of cpus
+ * given to the kernel as an affinity hint for the vector of register N, so that the
+ * power loss, ardma and transceiver interrupts can be steered to different cores.
+ *
  * The values written to each of these files should be in ASCII decimal.  Reading
  * from any of these files will return the value last written, also in ASCII decimal.
  *
@@ -70,7 +78,38 @@
  * interrupt_mask, registering an interrupt handler. Reading from 'init_trigger'
  * returns a positive initialization error if one occurred, or 0 for success.
  * After successful initialization attribute files become read only. Attempts at
- * changing their values results in a warning.
+ * changing their values results in a warning.  The read only init_duration_ns
+ * file reports the time spent in the kernel handling the init_trigger write,
+ * including the init_trigger callbacks of the modules like scd-hwmon.
+ *
+ * When ptp_offset_valid is set, the free running nanosecond counter at
+ * ptp_high_offset/ptp_low_offset is also registered as a PTP hardware clock
+ * (/dev/ptp<n>) once initialization completes.  The clock is read only, it can
+ * be used by phc2sys and friends as a reference but cannot be adjusted.
+ * While mapped, the counter is also sampled every ptp_page_interval_ms into a
+ * page exposed as the read only binary attribute ptp_time (struct scd_ptp_page
+ * in scd.h).
+ * Userspace can mmap it and extrapolate the time from the last sample with
+ * CLOCK_MONOTONIC without any syscall, see lib/scd-ptp.h.  Only the kernel reads
+ * the ptp registers, the latching read can't be shared with userspace.
+ *
+ * If the powerloss_record_addr module parameter points to memory reserved from
+ * the kernel (memmap=), the power loss interrupt writes a small binary record
+ * there before anything else (struct scd_powerloss_record in scd.h).  On the next
+ * load the previous record, if any, is available from /proc/scd_powerloss.
+ *
+ * Besides scd_read_register()/scd_write_register(), memory region 0 is available
+ * to other modules as a regmap (scd_get_regmap()), which serializes their
+ * read-modify-write accesses and gives the register dump in debugfs.  Nothing is
+ * cached, the registers are shared with userspace.  Ranges where a read has side
+ * effects (fifos) should be declared precious with scd_regmap_add_range() so that
+ * the debugfs dump leaves them alone.  Unlike the plain accessors, regmap
+ * accesses may sleep.
+ *
+ * Interrupts are handled in two halves.  The hard irq handler only reads the
+ * status and mask registers, masks the newly active bits and deals with power
+ * loss.  Everything else (revision sanity check, ardma callback, UIO notification,
+ * logging and accounting) is done by the irq thread.
  *
  * Each UIO device corresponds to a bit in the interrupt status/mask registers.
  * Reads on one of the UIO device files will complete when an interrupt has occurred
@@ -100,6 +139,23 @@
 #include <asm/nmi.h>
 #include <linux/sched.h>
 #include <linux/device.h>
+#include <linux/interrupt.h>
+#include <linux/cpumask.h>
+#include <linux/version.h>
+#include <linux/ptp_clock_kernel.h>
+#include <linux/regmap.h>
+#include <linux/mm.h>
+#include <linux/workqueue.h>
+
+#define CREATE_TRACE_POINTS
+#include "scd-trace.h"
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 0, 0)
+// system time sandwiching of the clock reads came with gettimex64
+struct ptp_system_timestamp;
+static inline void ptp_read_system_prets(struct ptp_system_timestamp *sts) {}
+static inline void ptp_read_system_postts(struct ptp_system_timestamp *sts) {}
+#endif
 
 #define SCD_MODULE_NAME "scd"
 
@@ -136,6 +192,8 @@
 # define _PAGE_CACHE_UC _PAGE_CACHE_MODE_UC
 #endif
 
+struct scd_dev_priv;
+
 typedef struct scd_irq_info_s {
    unsigned long interrupt_status_offset;
    unsigned long interrupt_mask_read_offset;
@@ -144,9 +202,23 @@ typedef struct scd_irq_info_s {
    unsigned long interrupt_mask;
    unsigned long interrupt_mask_powerloss;
    unsigned long interrupt_mask_ardma;
+   unsigned long interrupt_affinity;
    struct uio_info *uio_info[NUM_BITS_IN_WORD];
    unsigned long uio_count[NUM_BITS_IN_WORD];
    char uio_names[NUM_BITS_IN_WORD][40];
+
+   // bits masked by the hard irq half, waiting for the irq thread
+   u32 pending;
+   u32 last_status;
+   u32 last_mask;
+
+   // MSI-X vector dedicated to this interrupt register
+   struct scd_dev_priv *priv;
+   u32 index;
+   unsigned int msix_irq;
+   unsigned long msix_count;
+   cpumask_t affinity_mask;
+   char msix_name[40];
 } scd_irq_info_t;
 
 struct scd_dev_priv {
@@ -154,31 +226,53 @@ struct scd_dev_priv {
    struct pci_dev *pdev;
    void __iomem *mem;
    size_t mem_len;
-   spinlock_t ptp_time_spinlock;
+   struct ptp_clock *ptp_clock;
+   struct ptp_clock_info ptp_info;
+   struct bin_attribute ptp_time_attr;
+   bool ptp_time_attr_created;
+   struct scd_ptp_page *ptp_page;
+   struct delayed_work ptp_page_work;
+   // the work only runs while the page is mapped, protected by ptp_page_lock
+   struct mutex ptp_page_lock;
+   bool ptp_page_running;
+   struct regmap *regmap;
+   // register ranges declared by other modules, protected by regmap_lock
+   struct list_head regmap_ranges;
+   spinlock_t regmap_lock;
+   // protects the pending interrupt bits handed from hard irq to irq thread
+   spinlock_t intr_lock;
    scd_irq_info_t irq_info[SCD_NUM_IRQ_REGISTERS];
    unsigned long crc_error_irq;
    unsigned long crc_error_panic;
    unsigned long ptp_high_offset;
    unsigned long ptp_low_offset;
+   // serializes the latching read of the ptp registers
+   spinlock_t ptp_time_spinlock;
    unsigned long ptp_offset_valid;
    unsigned long msi_rearm_offset;
    unsigned long interrupt_irq;
    unsigned long ardma_offset;
    void __iomem *localbus;
    unsigned long init_error;
+   u64 init_duration_ns;
    bool initialized;
    unsigned int magic;
    bool sysfs_initialized;
    u32 revision;
-   u32 revision_error_reports;
+   atomic_t revision_error_reports;
    bool is_reconfig;
    unsigned long interrupt_poll;
    struct timer_list intr_poll_timer;
-
-   unsigned long interrupts;
-   unsigned long interrupt_claimed;
-   unsigned long interrupt_ardma_cnt;
-   unsigned long interrupt_powerloss_cnt;
+   unsigned long msix;
+   bool msix_enabled;
+   struct msix_entry msix_entries[SCD_NUM_IRQ_REGISTERS];
+   int msix_nvec;
+
+   // bumped from the handlers of every msi-x vector, which can run concurrently
+   atomic_long_t interrupts;
+   atomic_long_t interrupt_claimed;
+   atomic_long_t interrupt_ardma_cnt;
+   atomic_long_t interrupt_powerloss_cnt;
    const struct scd_driver_cb *driver_cb;
 
    int lpc_device;
@@ -214,6 +308,24 @@ static spinlock_t scd_ptp_lock;
 // nmi_priv points to the scd responsible for the nmi
 static struct scd_dev_priv *nmi_priv = NULL;
 
+// period of the samples of the ptp counter published through ptp_time
+static unsigned int ptp_page_interval_ms = 10;
+module_param(ptp_page_interval_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(ptp_page_interval_ms,
+                 "interval in ms between two samples of the ptp_time page");
+
+// reserved memory receiving the power loss record
+static unsigned long powerloss_record_addr;
+module_param(powerloss_record_addr, ulong, 0);
+MODULE_PARM_DESC(powerloss_record_addr,
+                 "physical address of the reserved power loss record area");
+static void __iomem *powerloss_record;
+// serializes the writes of the record when several scds lose power at once
+static spinlock_t scd_powerloss_lock;
+// record left by the previous boot, if any
+static struct scd_powerloss_record powerloss_last;
+static bool powerloss_last_valid;
+
 #define timestamped_watchdog_panic(msg) do {                            \
       struct timeval tv;                                                \
       struct tm t;                                                      \
@@ -392,143 +504,315 @@ EXPORT_SYMBOL(scd_register_ext_ops);
 EXPORT_SYMBOL(scd_unregister_ext_ops);
 EXPORT_SYMBOL(scd_ext_init_trigger);
 
-static irqreturn_t scd_interrupt(int irq, void *dev_id)
+// returns false if the scd revision register doesn't read back the expected value
+static bool scd_check_revision(struct scd_dev_priv *priv)
 {
-   struct device *dev = (struct device *) dev_id;
-   struct scd_dev_priv *priv = dev_get_drvdata(dev);
+   struct device *dev = &priv->pdev->dev;
+   u32 scd_ver;
+   int reports;
+
+   scd_ver = ioread32( priv->mem + SCD_REVISION_OFFSET );
+   if( scd_ver == priv->revision ) {
+      return true;
+   }
+
+   // sanity check to make sure we are not trying to read
+   // a scd that has just been hot removed before we
+   // have been notified.
+   // There is a problem with linecard hot removal, the power
+   // fails very slowly (10ms) and something manages to generate
+   // an interrupt, by the time we read the registers during the
+   // 10ms power down we can get garbage back, not just all Fs
+   // as you would expect from a powered down device.
+   if( scd_ver != 0xffffffff &&
+       atomic_read(&priv->revision_error_reports) < MAX_REV_ERR_RPTS ) {
+      // Update the revision for a reconfigurable fpga. BAR0 and BAR1 will
+      // initially read 0xdeadface until being reconfigured. After reconfig
+      // BAR0 will function as a scd and return the correct version number.
+      if(priv->is_reconfig && priv->revision == RECONFIG_STATE_BAR_VALUE) {
+         priv->revision = scd_ver;
+      } else {
+         // we got garbage, this is bad so let someone know about it, another
+         // vector may have used up the last report since the check above
+         reports = atomic_inc_return(&priv->revision_error_reports);
+         if(reports > MAX_REV_ERR_RPTS) {
+            return false;
+         }
+         dev_info( dev, "scd: irq chk 0x%x!=0x%x\n",
+                   priv->revision, scd_ver );
+         if(reports == MAX_REV_ERR_RPTS) {
+            // there appear to be some cases where the kernel gets
+            // very confused with the scd, the physical devices seem
+            // to have been switched association with the kernel device
+            // structures, dump out the name of one of the uio, it should allow
+            // us to see if the device structure has become confused.
+            dev_err(dev, "scd: rev mismatch overflow, uio[0]:%s\n",
+                    pci_name(priv->pdev));
+         }
+      }
+   }
+   return false;
+}
+
+static u64 scd_ptp_read(struct scd_dev_priv *priv, struct ptp_system_timestamp *sts);
+
+/*
+ * Save what we know about the power loss in the reserved memory area.
+ * This runs first thing in the hard irq handler and must stay short, the magic is
+ * written last so that a record cut short by the power going away is ignored.
+ * The last scd to report a power loss owns the record.
+ */
+static void scd_powerloss_save(struct scd_dev_priv *priv, u32 irq_reg,
+                               u32 status, u32 mask)
+{
+   struct scd_powerloss_record rec;
+   struct scd_dev_priv *ptp_priv;
+   unsigned long ptp_lock_flags;
+   unsigned long flags;
+
+   if (!powerloss_record) {
+      return;
+   }
+
+   memset(&rec, 0, sizeof(rec));
+   rec.version = SCD_POWERLOSS_VERSION;
+   rec.size = sizeof(rec);
+   rec.count = atomic_long_read(&priv->interrupt_powerloss_cnt) + 1;
+   rec.irq_reg = irq_reg;
+
+   // scd_ptp_lock keeps the master scd from going away under us
+   spin_lock_irqsave(&scd_ptp_lock, ptp_lock_flags);
+   ptp_priv = ptp_master_priv;
+   if (ptp_priv && ptp_priv->initialized &&
+       ptp_priv->ptp_offset_valid != SCD_UNINITIALIZED) {
+      rec.ptp_timestamp = scd_ptp_read(ptp_priv, NULL);
+   }
+   spin_unlock_irqrestore(&scd_ptp_lock, ptp_lock_flags);
+   rec.realtime_ns = ktime_to_ns(ktime_get_real());
+   rec.status = status;
+   rec.mask = mask;
+   rec.revision = priv->revision;
+   rec.pci_id = (priv->pdev->bus->number << 8) | priv->pdev->devfn;
+   rec.interrupts = atomic_long_read(&priv->interrupts);
+
+   spin_lock_irqsave(&scd_powerloss_lock, flags);
+   iowrite32(0, powerloss_record);
+   wmb();
+   memcpy_toio(powerloss_record + sizeof(rec.magic),
+               (u8 *)&rec + sizeof(rec.magic), sizeof(rec) - sizeof(rec.magic));
+   wmb();
+   iowrite32(SCD_POWERLOSS_MAGIC, powerloss_record);
+   spin_unlock_irqrestore(&scd_powerloss_lock, flags);
+}
+
+/*
+ * Hard irq half of the interrupt handling for one interrupt register.
+ * Only the bare minimum is done here with interrupts off: the newly active bits
+ * are masked and recorded as pending for the irq thread, and power loss is
+ * handled right away since there is no time left to wait for the thread.
+ * Callers must have checked the scd revision first.
+ */
+static irqreturn_t scd_interrupt_ack_register(struct scd_dev_priv *priv,
+                                              u32 irq_reg)
+{
+   scd_irq_info_t *info = &priv->irq_info[irq_reg];
    u32 interrupt_status;
    u32 interrupt_mask;
    u32 unmasked_interrupt_status;
+
+   interrupt_status = ioread32(priv->mem + info->interrupt_status_offset);
+   interrupt_mask = ioread32(priv->mem + info->interrupt_mask_read_offset);
+   unmasked_interrupt_status = interrupt_status & ~interrupt_mask;
+   trace_scd_irq_entry(priv->pdev, irq_reg, interrupt_status, interrupt_mask);
+
+   if (!unmasked_interrupt_status) {
+      /* No unmasked interrupt bits are active.  Therefore the interrupt didn't
+       * originate from the SCD. */
+      trace_scd_irq_exit(priv->pdev, irq_reg, 0);
+      return IRQ_NONE;
+   }
+
+   /* see if this is an powerLoss interrupt
+    this is to speed up the handling, we don't have much time if it is a
+    real power loss */
+   if(info->interrupt_mask_powerloss & unmasked_interrupt_status) {
+      scd_powerloss_save(priv, irq_reg, interrupt_status, interrupt_mask);
+      // it is the end of the line for this run, if this really is a power loss
+      // we will never complete the printk before the power dies
+      printk( KERN_INFO "Power Loss detected\n");
+      atomic_long_inc(&priv->interrupt_powerloss_cnt);
+   }
+
+   /* Mask all active interrupt bits.  Note that we must only mask the bits that
+   * were not already masked when we read the interrupt mask register above.
+   * Otherwise, we may mask a bit that has subsequently been cleared by a process
+   * running on another CPU, without generating another UIO event for that bit,
+   * causing that process to get stuck waiting for an interrupt that will never
+   * arrive. */
+   iowrite32(unmasked_interrupt_status, priv->mem + info->interrupt_mask_set_offset);
+
+   spin_lock(&priv->intr_lock);
+   info->pending |= unmasked_interrupt_status;
+   info->last_status = interrupt_status;
+   info->last_mask = interrupt_mask;
+   spin_unlock(&priv->intr_lock);
+
+   trace_scd_irq_exit(priv->pdev, irq_reg, unmasked_interrupt_status);
+   return IRQ_WAKE_THREAD;
+}
+
+/*
+ * Threaded half of the interrupt handling for one interrupt register.
+ * Dispatches the bits masked by scd_interrupt_ack_register to the ardma handler
+ * and the UIO devices.
+ */
+static irqreturn_t scd_interrupt_dispatch_register(struct scd_dev_priv *priv,
+                                                   u32 irq_reg)
+{
+   struct device *dev = &priv->pdev->dev;
+   scd_irq_info_t *info = &priv->irq_info[irq_reg];
+   unsigned long flags;
+   u32 interrupt_status;
+   u32 interrupt_mask;
+   u32 pending;
+   u32 dispatched;
+   u32 unexpected = 0;
+
+   spin_lock_irqsave(&priv->intr_lock, flags);
+   pending = info->pending;
+   interrupt_status = info->last_status;
+   interrupt_mask = info->last_mask;
+   info->pending = 0;
+   spin_unlock_irqrestore(&priv->intr_lock, flags);
+
+   if (!pending) {
+      return IRQ_NONE;
+   }
+
+   if(debug) {
+      dev_info(dev, "interrupt status 0x%x interrupt mask 0x%x "
+                    "interrupt status offset 0x%lx interrupt ",
+                    interrupt_status, interrupt_mask,
+                    info->interrupt_status_offset );
+   }
+
+   atomic_long_inc(&priv->interrupt_claimed);
+   dispatched = pending;
+
+   // ardma interrupt
+   if ((pending & info->interrupt_mask_ardma) && scd_ardma_ops) {
+      scd_ardma_ops->interrupt(priv->pdev);
+      pending &= ~info->interrupt_mask_ardma;
+      atomic_long_inc(&priv->interrupt_ardma_cnt);
+   }
+
+   /* Notify the UIO layer for each of the newly active interrupt bits. */
+   while (pending) {
+      int bit = ffs(pending) - 1;
+      if (likely(info->uio_info[bit])) {
+         uio_event_notify(info->uio_info[bit]);
+         info->uio_count[bit]++;
+      } else {
+         unexpected |= 1 << bit;
+      }
+      pending ^= (1 << bit);
+   }
+
+   trace_scd_irq_dispatch(priv->pdev, irq_reg, dispatched, unexpected);
+
+   if( unexpected ) {
+      dev_info(dev, "interrupt occurred for unexpected bits 0x%x "
+             "interrupt_status 0x%x, interrupt_mask 0x%x"
+             "scd_rev 0x%x interrupt status offset 0x%lx"
+             "uio mask is 0x%lx\n" ,
+             unexpected, interrupt_status,
+             interrupt_mask, priv->revision,
+             info->interrupt_status_offset,
+             info->interrupt_mask );
+   }
+
+   return IRQ_HANDLED;
+}
+
+static irqreturn_t scd_interrupt(int irq, void *dev_id)
+{
+   struct device *dev = (struct device *) dev_id;
+   struct scd_dev_priv *priv = dev_get_drvdata(dev);
    irqreturn_t rc = IRQ_NONE;
    u32 irq_reg;
-   u32 unexpected;
-   u32 scd_ver;
 
    WARN_ON_ONCE( priv->magic != SCD_MAGIC );
 
-   priv->interrupts++;
+   atomic_long_inc(&priv->interrupts);
+
+   // nothing read from an scd that fails this check can be acted upon, least of
+   // all a power loss
+   if( !scd_check_revision(priv) ) {
+      return IRQ_NONE;
+   }
+
    for(irq_reg = 0; irq_reg < SCD_NUM_IRQ_REGISTERS; irq_reg++) {
       if( !priv->irq_info[irq_reg].interrupt_status_offset ) {
           continue;
       }
 
-      scd_ver = ioread32( priv->mem + SCD_REVISION_OFFSET );
-      if( scd_ver != priv->revision ) {
-         // sanity check to make sure we are not trying to read
-         // a scd that has just been hot removed before we
-         // have been notified.
-         // There is a problem with linecard hot removal, the power
-         // fails very slowly (10ms) and something manages to generate
-         // an interrupt, by the time we read the registers during the
-         // 10ms power down we can get garbage back, not just all Fs
-         // as you would expect from a powered down device.
-         if( scd_ver != 0xffffffff &&
-             priv->revision_error_reports < MAX_REV_ERR_RPTS ) {
-            // Update the revision for a reconfigurable fpga. BAR0 and BAR1 will
-            // initially read 0xdeadface until being reconfigured. After reconfig
-            // BAR0 will function as a scd and return the correct version number.
-            if(priv->is_reconfig && priv->revision == RECONFIG_STATE_BAR_VALUE) {
-               priv->revision = scd_ver;
-            } else {
-               // we got garbage, this is bad so let someone know about it
-               dev_info( dev, "scd: irq chk 0x%x!=0x%x\n",
-                         priv->revision, scd_ver );
-               priv->revision_error_reports++;
-               if(priv->revision_error_reports == MAX_REV_ERR_RPTS) {
-                  // there appear to be some cases where the kernel gets
-                  // very confused with the scd, the physical devices seem
-                  // to have been switched association with the kernel device
-                  // structures, dump out the name of one of the uio, it should allow
-                  // us to see if the device structure has become confused.
-                  dev_err(dev, "scd: rev mismatch overflow, uio[0]:%s\n",
-                          pci_name(priv->pdev));
-               }
-            }
-         }
-         break;
+      if (scd_interrupt_ack_register(priv, irq_reg) == IRQ_WAKE_THREAD) {
+         rc = IRQ_WAKE_THREAD;
       }
+   }
 
+   /* If using MSI rearm message generation */
+   if (priv->msi_rearm_offset) {
+      iowrite32(1, priv->mem + priv->msi_rearm_offset);
+   }
 
-      unexpected = 0;
-      interrupt_status = ioread32(priv->mem +
-                                  priv->irq_info[irq_reg].interrupt_status_offset);
-      interrupt_mask = ioread32(priv->mem +
-                                priv->irq_info[irq_reg].interrupt_mask_read_offset);
-      unmasked_interrupt_status = interrupt_status & ~interrupt_mask;
+   return rc;
+}
 
-      if(debug) {
-         dev_info(dev, "interrupt status 0x%x interrupt mask 0x%x "
-                       "interrupt status offset 0x%lx interrupt ",
-                       interrupt_status, interrupt_mask,
-                       priv->irq_info[irq_reg].interrupt_status_offset );
-      }
+static irqreturn_t scd_interrupt_thread(int irq, void *dev_id)
+{
+   struct device *dev = (struct device *) dev_id;
+   struct scd_dev_priv *priv = dev_get_drvdata(dev);
+   irqreturn_t rc = IRQ_NONE;
+   u32 irq_reg;
 
-      if (!unmasked_interrupt_status) {
-         /* No unmasked interrupt bits are active.  Therefore the interrupt didn't
-          * originate from the SCD. */
-         continue;
+   for(irq_reg = 0; irq_reg < SCD_NUM_IRQ_REGISTERS; irq_reg++) {
+      if( !priv->irq_info[irq_reg].interrupt_status_offset ) {
+          continue;
       }
 
-      /* see if this is an powerLoss interrupt
-       this is to speed up the handling, we don't have much time if it is a
-       real power loss */
-      if(priv->irq_info[irq_reg].interrupt_mask_powerloss &
-         unmasked_interrupt_status) {
-         // it is the end of the line for this run, if this really is a power loss
-         // we will never complete the printk before the power dies
-         printk( KERN_INFO "Power Loss detected\n");
-         priv->interrupt_powerloss_cnt++;
+      if (scd_interrupt_dispatch_register(priv, irq_reg) == IRQ_HANDLED) {
+         rc = IRQ_HANDLED;
       }
+   }
 
-      rc = IRQ_HANDLED;
-      priv->interrupt_claimed++;
-      /* Mask all active interrupt bits.  Note that we must only mask the bits that
-      * were not already masked when we read the interrupt mask register above.
-      * Otherwise, we may mask a bit that has subsequently been cleared by a process
-      * running on another CPU, without generating another UIO event for that bit,
-      * causing that process to get stuck waiting for an interrupt that will never
-      * arrive. */
-      iowrite32(unmasked_interrupt_status, priv->mem +
-                priv->irq_info[irq_reg].interrupt_mask_set_offset);
-
-      // ardma interrupt
-      if ((unmasked_interrupt_status & priv->irq_info[irq_reg].interrupt_mask_ardma)
-          && scd_ardma_ops) {
-         scd_ardma_ops->interrupt(priv->pdev);
-         unmasked_interrupt_status &= ~priv->irq_info[irq_reg].interrupt_mask_ardma;
-         priv->interrupt_ardma_cnt++;
-      }
+   return rc;
+}
 
-      /* Notify the UIO layer for each of the newly active interrupt bits. */
-      while (unmasked_interrupt_status) {
-         int bit = ffs(unmasked_interrupt_status) - 1;
-         if (likely(priv->irq_info[irq_reg].uio_info[bit])) {
-            uio_event_notify(priv->irq_info[irq_reg].uio_info[bit]);
-            priv->irq_info[irq_reg].uio_count[bit]++;
-         } else {
-            unexpected |= 1 << bit;
-         }
-         unmasked_interrupt_status ^= (1 << bit);
-      }
+// MSI-X handler, each vector only looks at the interrupt register it is bound to
+static irqreturn_t scd_msix_interrupt(int irq, void *dev_id)
+{
+   scd_irq_info_t *info = (scd_irq_info_t *) dev_id;
+   struct scd_dev_priv *priv = info->priv;
 
-      if( unexpected ) {
-         dev_info(dev, "interrupt occurred for unexpected bits 0x%x "
-                "interrupt_status 0x%x, interrupt_mask 0x%x"
-                "scd_rev 0x%x interrupt status offset 0x%lx"
-                "uio mask is 0x%lx\n" ,
-                unexpected, interrupt_status,
-                interrupt_mask, scd_ver,
-                priv->irq_info[irq_reg].interrupt_status_offset,
-                priv->irq_info[irq_reg].interrupt_mask );
-      }
-   }
+   WARN_ON_ONCE( priv->magic != SCD_MAGIC );
 
-   /* If using MSI rearm message generation */
-   if (priv->msi_rearm_offset) {
-      iowrite32(1, priv->mem + priv->msi_rearm_offset);
+   atomic_long_inc(&priv->interrupts);
+   info->msix_count++;
+
+   if( !scd_check_revision(priv) ) {
+      return IRQ_NONE;
    }
 
-   return rc;
+   return scd_interrupt_ack_register(priv, info->index);
+}
+
+static irqreturn_t scd_msix_interrupt_thread(int irq, void *dev_id)
+{
+   scd_irq_info_t *info = (scd_irq_info_t *) dev_id;
+   struct scd_dev_priv *priv = info->priv;
+
+   return scd_interrupt_dispatch_register(priv, info->index);
 }
 
 static irqreturn_t scd_crc_error_interrupt(int irq, void *dev_id)
@@ -548,6 +832,115 @@ static irqreturn_t scd_crc_error_interrupt(int irq, void *dev_id)
    return IRQ_HANDLED;
 }
 
+static void scd_msix_disable(struct scd_dev_priv *priv)
+{
+   scd_irq_info_t *info;
+   int i;
+
+   for (i = 0; i < priv->msix_nvec; i++) {
+      info = &priv->irq_info[priv->msix_entries[i].entry];
+      if (!info->msix_irq) {
+         continue;
+      }
+      irq_set_affinity_hint(info->msix_irq, NULL);
+      free_irq(info->msix_irq, info);
+      info->msix_irq = 0;
+   }
+
+   if (priv->msix_enabled) {
+      pci_disable_msix(priv->pdev);
+      priv->msix_enabled = false;
+   }
+   priv->msix_nvec = 0;
+}
+
+static void scd_msix_set_affinity(scd_irq_info_t *info)
+{
+   unsigned long cpu;
+
+   cpumask_clear(&info->affinity_mask);
+   for_each_set_bit(cpu, &info->interrupt_affinity, BITS_PER_LONG) {
+      if (cpu < nr_cpu_ids) {
+         cpumask_set_cpu(cpu, &info->affinity_mask);
+      }
+   }
+
+   if (!cpumask_empty(&info->affinity_mask)) {
+      irq_set_affinity_hint(info->msix_irq, &info->affinity_mask);
+   }
+}
+
+static int scd_msix_enable(struct scd_dev_priv *priv)
+{
+   struct pci_dev *pdev = priv->pdev;
+   struct device *dev = &pdev->dev;
+   scd_irq_info_t *info;
+   u32 irq_reg;
+   int err;
+   int i;
+
+   priv->msix_nvec = 0;
+   for(irq_reg = 0; irq_reg < SCD_NUM_IRQ_REGISTERS; irq_reg++) {
+      if (!priv->irq_info[irq_reg].interrupt_status_offset) {
+         continue;
+      }
+      priv->msix_entries[priv->msix_nvec].entry = irq_reg;
+      priv->msix_nvec++;
+   }
+
+   if (!priv->msix_nvec) {
+      dev_err(dev, "msix requested without any interrupt register\n");
+      return -EINVAL;
+   }
+
+   err = pci_enable_msix_exact(pdev, priv->msix_entries, priv->msix_nvec);
+   if (err) {
+      dev_err(dev, "failed to enable %d msix vectors (%d)\n",
+              priv->msix_nvec, err);
+      priv->msix_nvec = 0;
+      return err;
+   }
+   priv->msix_enabled = true;
+   pci_set_master(pdev);
+
+   for (i = 0; i < priv->msix_nvec; i++) {
+      irq_reg = priv->msix_entries[i].entry;
+      info = &priv->irq_info[irq_reg];
+      info->priv = priv;
+      info->index = irq_reg;
+      snprintf(info->msix_name, sizeof(info->msix_name), "%s-%s-%u",
+               SCD_MODULE_NAME, pci_name(pdev), irq_reg);
+
+      err = request_threaded_irq(priv->msix_entries[i].vector,
+                                 scd_msix_interrupt, scd_msix_interrupt_thread,
+                                 0, info->msix_name, info);
+      if (err) {
+         dev_err(dev, "failed to request msix irq %u for register %u (%d)\n",
+                 priv->msix_entries[i].vector, irq_reg, err);
+         scd_msix_disable(priv);
+         return err;
+      }
+      info->msix_irq = priv->msix_entries[i].vector;
+      scd_msix_set_affinity(info);
+   }
+
+   return 0;
+}
+
+// release the interrupt line(s) requested by scd_finish_init
+static void scd_free_irqs(struct scd_dev_priv *priv, unsigned int irq)
+{
+   if (priv->msix_enabled) {
+      scd_msix_disable(priv);
+      return;
+   }
+
+   free_irq(irq, &priv->pdev->dev);
+   if (priv->msi_rearm_offset) {
+      pci_disable_msi(priv->pdev);
+   }
+}
+
 static int scd_finish_init(struct device *dev)
 {
    struct scd_dev_priv *priv = dev_get_drvdata(dev);
@@ -594,23 +987,31 @@ static int scd_finish_init(struct device *dev)
       }
    }
 
-   if (priv->msi_rearm_offset) {
-      err = pci_enable_msi(to_pci_dev(dev));
-      if (err) {
-         dev_err(dev, "failed to enable msi (%d)\n", err);
-         goto err_out;
-      }
-      pci_set_master(to_pci_dev(dev));
-   }
-
    /* if interrupt_irq has been set, use it instead of pdev->irq */
    irq = (priv->interrupt_irq != SCD_UNINITIALIZED) ?
       priv->interrupt_irq : to_pci_dev(dev)->irq;
 
-   err = request_irq(irq, scd_interrupt, IRQF_SHARED, SCD_MODULE_NAME, dev);
-   if (err) {
-      dev_err(dev, "failed to request irq %d (%d)\n", irq, err);
-      goto err_out_misc_dereg;
+   if (priv->msix) {
+      err = scd_msix_enable(priv);
+      if (err) {
+         goto err_out;
+      }
+   } else {
+      if (priv->msi_rearm_offset) {
+         err = pci_enable_msi(to_pci_dev(dev));
+         if (err) {
+            dev_err(dev, "failed to enable msi (%d)\n", err);
+            goto err_out;
+         }
+         pci_set_master(to_pci_dev(dev));
+      }
+
+      err = request_threaded_irq(irq, scd_interrupt, scd_interrupt_thread,
+                                 IRQF_SHARED, SCD_MODULE_NAME, dev);
+      if (err) {
+         dev_err(dev, "failed to request irq %d (%d)\n", irq, err);
+         goto err_out_misc_dereg;
+      }
    }
 
    if (priv->crc_error_irq != SCD_UNINITIALIZED) {
@@ -661,7 +1062,7 @@ static int scd_finish_init(struct device *dev)
    }
 
    // If using MSI rearm message generation
-   if (priv->msi_rearm_offset) {
+   if (priv->msi_rearm_offset && !priv->msix_enabled) {
       iowrite32(1, priv->mem + priv->msi_rearm_offset);
    }
 
@@ -678,7 +1079,8 @@ static int scd_finish_init(struct device *dev)
    return 0;
 
 err_out_free_irq:
-   free_irq(irq, dev);
+   scd_free_irqs(priv, irq);
+   goto err_out;
 
 err_out_misc_dereg:
    if (priv->msi_rearm_offset) {
@@ -763,7 +1165,8 @@ SCD_IRQ_DEVICE_ATTR(interrupt_mask_set_offset, num); \
 SCD_IRQ_DEVICE_ATTR(interrupt_mask_clear_offset, num); \
 SCD_IRQ_DEVICE_ATTR(interrupt_mask, num); \
 SCD_IRQ_DEVICE_ATTR(interrupt_mask_powerloss, num); \
-SCD_IRQ_DEVICE_ATTR(interrupt_mask_ardma, num);
+SCD_IRQ_DEVICE_ATTR(interrupt_mask_ardma, num); \
+SCD_IRQ_DEVICE_ATTR(interrupt_affinity, num);
 
 #define SCD_IRQ_ATTRS_POINTERS(num) \
 &dev_attr_interrupt_status_offset##num.attr, \
@@ -772,7 +1175,8 @@ SCD_IRQ_DEVICE_ATTR(interrupt_mask_ardma, num);
 &dev_attr_interrupt_mask_clear_offset##num.attr, \
 &dev_attr_interrupt_mask##num.attr, \
 &dev_attr_interrupt_mask_powerloss##num.attr, \
-&dev_attr_interrupt_mask_ardma##num.attr
+&dev_attr_interrupt_mask_ardma##num.attr, \
+&dev_attr_interrupt_affinity##num.attr
 
 struct pci_dev *
 scd_get_pdev(const char *name)
@@ -806,6 +1210,7 @@ scd_read_register(struct pci_dev *pdev, u32 offset)
       res = ioread32(reg);
    }
    dev_dbg(&pdev->dev, "io:read 0x%04x => 0x%08x", offset, res);
+   trace_scd_reg_read(pdev, offset, res);
    return res;
 }
 EXPORT_SYMBOL(scd_read_register);
@@ -820,6 +1225,7 @@ scd_write_register(struct pci_dev *pdev, u32 offset, u32 val)
    ASSERT( priv );
    ASSERT( offset < priv->mem_len );
    dev_dbg(&pdev->dev, "io:write 0x%04x <= 0x%08x", offset, val);
+   trace_scd_reg_write(pdev, offset, val);
    if (priv) {
       reg = priv->mem + offset;
       iowrite32(val, reg);
@@ -840,38 +1246,487 @@ scd_resource_len(struct pci_dev *pdev)
 }
 EXPORT_SYMBOL(scd_resource_len);
 
+struct scd_regmap_range {
+   struct list_head list;
+   u32 start;
+   u32 end;
+   unsigned int flags;
+};
+
+static bool scd_regmap_range_has(struct scd_dev_priv *priv, unsigned int reg,
+                                 unsigned int flags)
+{
+   struct scd_regmap_range *range;
+   unsigned long lock_flags;
+   bool found = false;
+
+   spin_lock_irqsave(&priv->regmap_lock, lock_flags);
+   list_for_each_entry(range, &priv->regmap_ranges, list) {
+      if (reg >= range->start && reg <= range->end && (range->flags & flags)) {
+         found = true;
+         break;
+      }
+   }
+   spin_unlock_irqrestore(&priv->regmap_lock, lock_flags);
+
+   return found;
+}
+
+static bool scd_regmap_precious_reg(struct device *dev, unsigned int reg)
+{
+   return scd_regmap_range_has(dev_get_drvdata(dev), reg, SCD_REGMAP_PRECIOUS);
+}
+
+static int scd_regmap_init(struct scd_dev_priv *priv)
+{
+   struct regmap_config config = {
+      .name = SCD_MODULE_NAME,
+      .reg_bits = 32,
+      .val_bits = 32,
+      .reg_stride = 4,
+      .precious_reg = scd_regmap_precious_reg,
+   };
+   struct regmap *regmap;
+
+   if (!priv->mem || priv->mem_len < 4) {
+      return 0;
+   }
+
+   config.max_register = priv->mem_len - 4;
+   regmap = regmap_init_mmio(&priv->pdev->dev, priv->mem, &config);
+   if (IS_ERR(regmap)) {
+      dev_err(&priv->pdev->dev, "failed to create regmap (%ld)\n",
+              PTR_ERR(regmap));
+      return PTR_ERR(regmap);
+   }
+
+   priv->regmap = regmap;
+   return 0;
+}
+
+static void scd_regmap_exit(struct scd_dev_priv *priv)
+{
+   struct scd_regmap_range *range, *tmp;
+
+   if (priv->regmap) {
+      regmap_exit(priv->regmap);
+      priv->regmap = NULL;
+   }
+
+   list_for_each_entry_safe(range, tmp, &priv->regmap_ranges, list) {
+      list_del(&range->list);
+      kfree(range);
+   }
+}
+
+struct regmap *
+scd_get_regmap(struct pci_dev *pdev)
+{
+   struct scd_dev_priv *priv;
+
+   priv = pci_get_drvdata(pdev);
+   ASSERT( priv );
+   if (priv)
+      return priv->regmap;
+   return NULL;
+}
+EXPORT_SYMBOL(scd_get_regmap);
+
+// declare the registers between start and end (inclusive) as precious
+int
+scd_regmap_add_range(struct pci_dev *pdev, u32 start, u32 end, unsigned int flags)
+{
+   struct scd_dev_priv *priv = pci_get_drvdata(pdev);
+   struct scd_regmap_range *range;
+   unsigned long lock_flags;
+
+   if (!priv || !priv->regmap) {
+      return -ENODEV;
+   }
+
+   if (start > end || end >= priv->mem_len || (start | end) & 0x3) {
+      return -EINVAL;
+   }
+
+   range = kzalloc(sizeof(*range), GFP_KERNEL);
+   if (!range) {
+      return -ENOMEM;
+   }
+   range->start = start;
+   range->end = end;
+   range->flags = flags;
+
+   spin_lock_irqsave(&priv->regmap_lock, lock_flags);
+   list_add_tail(&range->list, &priv->regmap_ranges);
+   spin_unlock_irqrestore(&priv->regmap_lock, lock_flags);
+
+   return 0;
+}
+EXPORT_SYMBOL(scd_regmap_add_range);
+
+void
+scd_regmap_remove_range(struct pci_dev *pdev, u32 start, u32 end)
+{
+   struct scd_dev_priv *priv = pci_get_drvdata(pdev);
+   struct scd_regmap_range *range, *tmp;
+   unsigned long lock_flags;
+
+   if (!priv || !priv->regmap) {
+      return;
+   }
+
+   spin_lock_irqsave(&priv->regmap_lock, lock_flags);
+   list_for_each_entry_safe(range, tmp, &priv->regmap_ranges, list) {
+      if (range->start == start && range->end == end) {
+         list_del(&range->list);
+         kfree(range);
+         break;
+      }
+   }
+   spin_unlock_irqrestore(&priv->regmap_lock, lock_flags);
+}
+EXPORT_SYMBOL(scd_regmap_remove_range);
+
+/*
+ * Read the ptp counter.
+ * Reading the high register also latches the current time into the low
+ * register, so we don't need any special handling of the rollover case, but
+ * another reader latching in between would hand us its low word: the pair must be
+ * read under ptp_time_spinlock.  When sts is given, the system time is sampled
+ * around the read of the high register since that is when the time is latched.
+ * This is also called from the hard irq handler on power loss.
+ */
+static u64 scd_ptp_read(struct scd_dev_priv *priv, struct ptp_system_timestamp *sts)
+{
+   unsigned long flags;
+   u32 high, low;
+
+   ASSERT(priv->ptp_low_offset != SCD_UNINITIALIZED);
+   ASSERT(priv->ptp_high_offset != SCD_UNINITIALIZED);
+
+   spin_lock_irqsave(&priv->ptp_time_spinlock, flags);
+   ptp_read_system_prets(sts);
+   high = ioread32(priv->mem + priv->ptp_high_offset);
+   ptp_read_system_postts(sts);
+   low = ioread32(priv->mem + priv->ptp_low_offset);
+   spin_unlock_irqrestore(&priv->ptp_time_spinlock, flags);
+
+   return (((u64)high) << 32) | low;
+}
+
 // scd_list_lock mutex is not held in this function.
 // scd_lock mutex is not held in this function.
 u64
 scd_ptp_timestamp(void)
 {
-   unsigned long flags, ptp_lock_flags;
+   unsigned long ptp_lock_flags;
    u64 ts = 0;
-   u32 low = 0;
-   u32 high = 0;
-   struct scd_dev_priv *priv = ptp_master_priv;
+   struct scd_dev_priv *priv;
 
+   // scd_ptp_lock only keeps the master scd from going away under us
    spin_lock_irqsave(&scd_ptp_lock, ptp_lock_flags);
 
+   priv = ptp_master_priv;
    if (priv && priv->initialized && (priv->ptp_offset_valid != SCD_UNINITIALIZED)) {
-      ASSERT(priv->ptp_low_offset != SCD_UNINITIALIZED);
-      ASSERT(priv->ptp_high_offset != SCD_UNINITIALIZED);
-      // Reading the high register also latches the current time into the low
-      // register, so we don't need any special handling of the rollover case.
-      spin_lock_irqsave(&priv->ptp_time_spinlock, flags);
-      high = ioread32(priv->mem + priv->ptp_high_offset);
-      low = ioread32(priv->mem + priv->ptp_low_offset);
-      spin_unlock_irqrestore(&priv->ptp_time_spinlock, flags);
-      ts = (((u64)high) << 32) | low;
+      ts = scd_ptp_read(priv, NULL);
    }
 
    spin_unlock_irqrestore(&scd_ptp_lock, ptp_lock_flags);
    if (ts == 0)
-      printk(KERN_INFO "%s %s returned zero\n", SCD_MODULE_NAME, __FUNCTION__);
+      pr_debug("%s %s returned zero\n", SCD_MODULE_NAME, __FUNCTION__);
 
    return (ts);
 }
 
+#if IS_ENABLED(CONFIG_PTP_1588_CLOCK)
+
+/*
+ * PTP hardware clock backed by the scd time counter.
+ * The counter is owned by the hardware and free running, only reading it is
+ * supported.
+ */
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+static int scd_ptp_gettimex64(struct ptp_clock_info *ptp, struct timespec64 *ts,
+                              struct ptp_system_timestamp *sts)
+{
+   struct scd_dev_priv *priv = container_of(ptp, struct scd_dev_priv, ptp_info);
+
+   *ts = ns_to_timespec64(scd_ptp_read(priv, sts));
+   return 0;
+}
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(4, 1, 0)
+static int scd_ptp_gettime64(struct ptp_clock_info *ptp, struct timespec64 *ts)
+{
+   struct scd_dev_priv *priv = container_of(ptp, struct scd_dev_priv, ptp_info);
+
+   *ts = ns_to_timespec64(scd_ptp_read(priv, NULL));
+   return 0;
+}
+#else
+static int scd_ptp_gettime(struct ptp_clock_info *ptp, struct timespec *ts)
+{
+   struct scd_dev_priv *priv = container_of(ptp, struct scd_dev_priv, ptp_info);
+
+   *ts = ns_to_timespec(scd_ptp_read(priv, NULL));
+   return 0;
+}
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 1, 0)
+static int scd_ptp_settime64(struct ptp_clock_info *ptp, const struct timespec64 *ts)
+{
+   return -EOPNOTSUPP;
+}
+#else
+static int scd_ptp_settime(struct ptp_clock_info *ptp, const struct timespec *ts)
+{
+   return -EOPNOTSUPP;
+}
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)
+static int scd_ptp_adjfine(struct ptp_clock_info *ptp, long scaled_ppm)
+{
+   return -EOPNOTSUPP;
+}
+#else
+static int scd_ptp_adjfreq(struct ptp_clock_info *ptp, s32 delta)
+{
+   return -EOPNOTSUPP;
+}
+#endif
+
+static int scd_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
+{
+   return -EOPNOTSUPP;
+}
+
+static int scd_ptp_enable(struct ptp_clock_info *ptp,
+                          struct ptp_clock_request *rq, int on)
+{
+   return -EOPNOTSUPP;
+}
+
+static const struct ptp_clock_info scd_ptp_info = {
+   .owner = THIS_MODULE,
+   .name = SCD_MODULE_NAME,
+   .max_adj = 0,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+   .gettimex64 = scd_ptp_gettimex64,
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(4, 1, 0)
+   .gettime64 = scd_ptp_gettime64,
+#else
+   .gettime = scd_ptp_gettime,
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 1, 0)
+   .settime64 = scd_ptp_settime64,
+#else
+   .settime = scd_ptp_settime,
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)
+   .adjfine = scd_ptp_adjfine,
+#else
+   .adjfreq = scd_ptp_adjfreq,
+#endif
+   .adjtime = scd_ptp_adjtime,
+   .enable = scd_ptp_enable,
+};
+
+// scd_lock mutex is held in this function.
+static void scd_ptp_register(struct scd_dev_priv *priv)
+{
+   struct device *dev = &priv->pdev->dev;
+   struct ptp_clock *clock;
+
+   if (priv->ptp_offset_valid == SCD_UNINITIALIZED) {
+      return;
+   }
+
+   priv->ptp_info = scd_ptp_info;
+   clock = ptp_clock_register(&priv->ptp_info, dev);
+   if (IS_ERR_OR_NULL(clock)) {
+      // not fatal, scd_ptp_timestamp() keeps working without the ptp clock
+      dev_warn(dev, "failed to register ptp clock (%ld)\n", PTR_ERR(clock));
+      return;
+   }
+
+   priv->ptp_clock = clock;
+   dev_info(dev, "registered ptp clock %d\n", ptp_clock_index(clock));
+}
+
+static void scd_ptp_unregister(struct scd_dev_priv *priv)
+{
+   if (priv->ptp_clock) {
+      ptp_clock_unregister(priv->ptp_clock);
+      priv->ptp_clock = NULL;
+   }
+}
+
+#else
+
+static void scd_ptp_register(struct scd_dev_priv *priv)
+{
+}
+
+static void scd_ptp_unregister(struct scd_dev_priv *priv)
+{
+}
+
+#endif /* CONFIG_PTP_1588_CLOCK */
+
+/*
+ * The ptp_time page is only written by this work, seq makes the sample
+ * consistent for the readers in userspace.
+ */
+static void scd_ptp_page_update(struct scd_dev_priv *priv)
+{
+   struct scd_ptp_page *page = priv->ptp_page;
+   ktime_t before;
+   ktime_t after;
+   u64 ptp;
+
+   before = ktime_get();
+   ptp = scd_ptp_read(priv, NULL);
+   after = ktime_get();
+
+   page->seq++;
+   smp_wmb();
+   page->ptp_ns = ptp;
+   page->monotonic_ns = ktime_to_ns(before) +
+                        (ktime_to_ns(ktime_sub(after, before)) >> 1);
+   smp_wmb();
+   page->seq++;
+}
+
+static bool scd_ptp_page_mapped(struct scd_dev_priv *priv)
+{
+   struct page *page = virt_to_page(priv->ptp_page);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0)
+   return folio_mapcount(page_folio(page)) > 0;
+#else
+   return page_mapcount(page) > 0;
+#endif
+}
+
+/*
+ * sysfs does not let the mapping have a close callback, the work stops on its
+ * own once the page is not mapped anymore and the next mmap starts it again.
+ */
+static void scd_ptp_page_work_fn(struct work_struct *work)
+{
+   struct scd_dev_priv *priv = container_of(to_delayed_work(work),
+                                            struct scd_dev_priv, ptp_page_work);
+
+   mutex_lock(&priv->ptp_page_lock);
+   if (scd_ptp_page_mapped(priv)) {
+      scd_ptp_page_update(priv);
+      schedule_delayed_work(&priv->ptp_page_work,
+                            msecs_to_jiffies(ptp_page_interval_ms));
+   } else {
+      priv->ptp_page_running = false;
+   }
+   mutex_unlock(&priv->ptp_page_lock);
+}
+
+/*
+ * The ptp_time attribute maps the page published by scd_ptp_page_update, read
+ * only.  The page is referenced by the mapping so that it outlives the scd.
+ */
+static int
+scd_ptp_time_mmap(struct file *filp, struct kobject *kobj,
+                  struct bin_attribute *attr,
+                  struct vm_area_struct *vma)
+{
+   struct device *dev = container_of(kobj, struct device, kobj);
+   struct scd_dev_priv *priv = dev_get_drvdata(dev);
+   int err;
+
+   if (vma->vm_pgoff || vma->vm_end - vma->vm_start != PAGE_SIZE) {
+      return -EINVAL;
+   }
+
+   if (vma->vm_flags & VM_WRITE) {
+      return -EPERM;
+   }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+   vm_flags_clear(vma, VM_MAYWRITE);
+#else
+   vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+   err = vm_insert_page(vma, vma->vm_start, virt_to_page(priv->ptp_page));
+   if (err) {
+      return err;
+   }
+
+   // the page is mapped before the work looks at it, it can't stop under us
+   mutex_lock(&priv->ptp_page_lock);
+   if (!priv->ptp_page_running) {
+      scd_ptp_page_update(priv);
+      schedule_delayed_work(&priv->ptp_page_work,
+                            msecs_to_jiffies(ptp_page_interval_ms));
+      priv->ptp_page_running = true;
+   }
+   mutex_unlock(&priv->ptp_page_lock);
+
+   return 0;
+}
+
+// scd_lock mutex is held in this function.
+static void scd_ptp_time_create(struct scd_dev_priv *priv)
+{
+   struct device *dev = &priv->pdev->dev;
+   int err;
+
+   if (priv->ptp_offset_valid == SCD_UNINITIALIZED || !ptp_page_interval_ms) {
+      return;
+   }
+
+   priv->ptp_page = (struct scd_ptp_page *)get_zeroed_page(GFP_KERNEL);
+   if (!priv->ptp_page) {
+      dev_warn(dev, "failed to allocate the ptp_time page\n");
+      return;
+   }
+   priv->ptp_page->version = SCD_PTP_PAGE_VERSION;
+   priv->ptp_page->interval_ns = (u64)ptp_page_interval_ms * NSEC_PER_MSEC;
+   scd_ptp_page_update(priv);
+
+   INIT_DELAYED_WORK(&priv->ptp_page_work, scd_ptp_page_work_fn);
+   mutex_init(&priv->ptp_page_lock);
+   priv->ptp_page_running = false;
+
+   sysfs_bin_attr_init(&priv->ptp_time_attr);
+   priv->ptp_time_attr.attr.name = "ptp_time";
+   priv->ptp_time_attr.attr.mode = S_IRUSR | S_IRGRP;
+   priv->ptp_time_attr.size = PAGE_SIZE;
+   priv->ptp_time_attr.mmap = scd_ptp_time_mmap;
+   err = sysfs_create_bin_file(&dev->kobj, &priv->ptp_time_attr);
+   if (err) {
+      dev_warn(dev, "failed to create ptp_time attribute (%d)\n", err);
+      goto fail_page;
+   }
+
+   priv->ptp_time_attr_created = true;
+   return;
+
+fail_page:
+   free_page((unsigned long)priv->ptp_page);
+   priv->ptp_page = NULL;
+}
+
+static void scd_ptp_time_remove(struct scd_dev_priv *priv)
+{
+   if (priv->ptp_time_attr_created) {
+      sysfs_remove_bin_file(&priv->pdev->dev.kobj, &priv->ptp_time_attr);
+      priv->ptp_time_attr_created = false;
+      cancel_delayed_work_sync(&priv->ptp_page_work);
+      // existing mappings hold their own reference on the page
+      free_page((unsigned long)priv->ptp_page);
+      priv->ptp_page = NULL;
+   }
+}
+
 static ssize_t show_init_trigger(struct device *dev, struct device_attribute *attr,
                                  char *buf)
 {
@@ -883,6 +1738,7 @@ static ssize_t store_init_trigger(struct device *dev, struct device_attribute *a
                                   const char *buf, size_t count)
 {
    struct scd_dev_priv *priv;
+   ktime_t start;
    int error = 0;
 
    priv = dev_get_drvdata(dev);
@@ -896,9 +1752,13 @@ static ssize_t store_init_trigger(struct device *dev, struct device_attribute *a
    }
 
    if (!priv->initialized) {
+      start = ktime_get();
       if (!(error = scd_finish_init(dev))) {
          priv->initialized = 1;
+         scd_ptp_register(priv);
+         scd_ptp_time_create(priv);
       }
+      priv->init_duration_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
    }
 
    // Save the error code from scd_finish_init.
@@ -911,6 +1771,13 @@ static ssize_t store_init_trigger(struct device *dev, struct device_attribute *a
    return error ? error : count;
 }
 
+static ssize_t show_init_duration_ns(struct device *dev,
+                                     struct device_attribute *attr, char *buf)
+{
+   struct scd_dev_priv *priv = dev_get_drvdata(dev);
+   return sprintf(buf, "%llu\n", (unsigned long long)priv->init_duration_ns);
+}
+
 static ssize_t scd_set_debug(struct device *dev, struct device_attribute *attr,
                              const char *buf, size_t count) {
     sscanf( buf, "%d", &debug );
@@ -964,6 +1831,7 @@ static ssize_t scd_set_nmi_control_reg_addr(struct device *dev,
 
 static DEVICE_ATTR(init_trigger, S_IRUGO|S_IWUSR|S_IWGRP,
                    show_init_trigger, store_init_trigger);
+static DEVICE_ATTR(init_duration_ns, S_IRUGO, show_init_duration_ns, NULL);
 static DEVICE_ATTR(debug, S_IWUSR|S_IWGRP, NULL, scd_set_debug );
 static DEVICE_ATTR(ptp_offset_valid, S_IWUSR|S_IWGRP,
                    NULL, scd_set_ptp_offset_valid );
@@ -978,6 +1846,7 @@ SCD_DEVICE_ATTR(msi_rearm_offset);
 SCD_DEVICE_ATTR(interrupt_irq);
 SCD_DEVICE_ATTR(ardma_offset);
 SCD_DEVICE_ATTR(interrupt_poll);
+SCD_DEVICE_ATTR(msix);
 
 SCD_DEVICE_ATTR(nmi_port_io_p);
 SCD_DEVICE_ATTR(nmi_control_mask);
@@ -1013,7 +1882,9 @@ static struct attribute *scd_attrs[] = {
    &dev_attr_interrupt_irq.attr,
    &dev_attr_ardma_offset.attr,
    &dev_attr_init_trigger.attr,
+   &dev_attr_init_duration_ns.attr,
    &dev_attr_interrupt_poll.attr,
+   &dev_attr_msix.attr,
    &dev_attr_debug.attr,
    &dev_attr_nmi_port_io_p.attr,
    &dev_attr_nmi_control_reg_addr.attr,
@@ -1185,6 +2056,8 @@ static int scd_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 
    memset(priv, 0, sizeof (struct scd_dev_priv));
    INIT_LIST_HEAD(&priv->list);
+   INIT_LIST_HEAD(&priv->regmap_ranges);
+   spin_lock_init(&priv->regmap_lock);
    priv->pdev = pdev;
    priv->crc_error_irq = SCD_UNINITIALIZED;
    priv->crc_error_panic = SCD_UNINITIALIZED;
@@ -1206,6 +2079,7 @@ static int scd_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
    priv->nmi_gpio_status_mask = SCD_UNINITIALIZED;
    priv->nmi_registered = false;
 
+   spin_lock_init(&priv->intr_lock);
    spin_lock_init(&priv->ptp_time_spinlock);
    priv->magic = SCD_MAGIC;
    priv->localbus = NULL;
@@ -1218,6 +2092,11 @@ static int scd_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
       goto fail;
    }
 
+   err = scd_regmap_init(priv);
+   if (err) {
+      goto fail;
+   }
+
    err = sysfs_create_group(&pdev->dev.kobj, &scd_attr_group);
    if (err) {
       dev_err(&pdev->dev, "sysfs_create_group() error %d\n", err);
@@ -1254,7 +2133,10 @@ static void scd_interrupt_poll( unsigned long data )
 {
    struct scd_dev_priv * dev = ( struct scd_dev_priv * ) data;
    struct pci_dev * pdev = dev->pdev;
-   scd_interrupt( 0, ( void* ) &pdev->dev );
+   // the poll timer runs both halves inline, nothing in the dispatch sleeps
+   if( scd_interrupt( 0, ( void* ) &pdev->dev ) == IRQ_WAKE_THREAD ) {
+      scd_interrupt_thread( 0, ( void* ) &pdev->dev );
+   }
    dev->intr_poll_timer.expires = jiffies + INTR_POLL_INTERVAL;
    add_timer( &dev->intr_poll_timer );
 }
@@ -1262,6 +2144,7 @@ static void scd_interrupt_poll( unsigned long data )
 static void scd_remove(struct pci_dev *pdev)
 {
    struct scd_dev_priv *priv = pci_get_drvdata(pdev);
+   unsigned long flags;
    unsigned int irq;
    int i;
    u32 irq_reg;
@@ -1269,11 +2152,15 @@ static void scd_remove(struct pci_dev *pdev)
    if (priv == NULL)
       return;
 
-   spin_lock(&scd_ptp_lock);
+   // irqs off, the power loss handler takes scd_ptp_lock from the hard irq
+   spin_lock_irqsave(&scd_ptp_lock, flags);
    if(ptp_master_priv == priv) {
       ptp_master_priv = NULL;
    }
-   spin_unlock(&scd_ptp_lock);
+   spin_unlock_irqrestore(&scd_ptp_lock, flags);
+
+   scd_ptp_unregister(priv);
+   scd_ptp_time_remove(priv);
 
    scd_lock();
 
@@ -1313,14 +2200,14 @@ static void scd_remove(struct pci_dev *pdev)
 
    if (priv->initialized) {
       scd_mask_interrupts(priv);
-      free_irq(irq, &pdev->dev);
       if (priv->crc_error_irq != SCD_UNINITIALIZED)
          free_irq(priv->crc_error_irq, &pdev->dev);
-      if (priv->msi_rearm_offset) {
-         pci_disable_msi(pdev);
-      }
+      scd_free_irqs(priv, irq);
    }
 
+   // the regmap has to go before the memory region is unmapped
+   scd_regmap_exit(priv);
+
    // call pci bits to release
    priv->driver_cb->disable( pdev );
 
@@ -1416,9 +2303,10 @@ static int scd_dump(struct seq_file *m, void *p) {
       if(priv->magic == SCD_MAGIC) {
          seq_printf(m, "scd %s\n", pci_name(priv->pdev));
 
-         seq_printf(m, "revision 0x%x revision_error_reports %u\n",
+         seq_printf(m, "revision 0x%x revision_error_reports %d\n",
                        priv->revision,
-                       priv->revision_error_reports);
+                       min(atomic_read(&priv->revision_error_reports),
+                           MAX_REV_ERR_RPTS));
 
          seq_printf(m, "initialized %d sysfs_initialized %d"
                        " interrupt_poll %lu magic 0x%x"
@@ -1468,8 +2356,19 @@ static int scd_dump(struct seq_file *m, void *p) {
          }
 
          seq_printf(m, "irq %u\n", priv->pdev->irq );
+         if (priv->msix_enabled) {
+            for (i = 0; i < priv->msix_nvec; i++) {
+               irq_reg = priv->msix_entries[i].entry;
+               seq_printf(m, "msix register %u irq %u affinity 0x%lx"
+                             " interrupts %lu\n", irq_reg,
+                          priv->irq_info[irq_reg].msix_irq,
+                          priv->irq_info[irq_reg].interrupt_affinity,
+                          priv->irq_info[irq_reg].msix_count);
+            }
+         }
          seq_printf(m, "interrupts %lu interrupts_claimed %lu\n",
-                        priv->interrupts, priv->interrupt_claimed );
+                        atomic_long_read(&priv->interrupts),
+                        atomic_long_read(&priv->interrupt_claimed) );
 
          seq_printf(m, "interrupt status bit counts:\n");
 
@@ -1487,11 +2386,12 @@ static int scd_dump(struct seq_file *m, void *p) {
                }
             }
 
-            if(priv->interrupt_ardma_cnt)
-               seq_printf(m, "ardma interrupts %lu ", priv->interrupt_ardma_cnt);
-            if(priv->interrupt_powerloss_cnt)
+            if(atomic_long_read(&priv->interrupt_ardma_cnt))
+               seq_printf(m, "ardma interrupts %lu ",
+                          atomic_long_read(&priv->interrupt_ardma_cnt));
+            if(atomic_long_read(&priv->interrupt_powerloss_cnt))
                seq_printf(m, "power loss interrupts %lu\n",
-                              priv->interrupt_powerloss_cnt);
+                          atomic_long_read(&priv->interrupt_powerloss_cnt));
          }
       }
       seq_printf(m, "\n");
@@ -1513,13 +2413,74 @@ static const struct file_operations scd_dump_file_ops = {
    .release = single_release,
 };
 
+static ssize_t scd_powerloss_read(struct file *file, char __user *buf,
+                                  size_t count, loff_t *ppos)
+{
+   if (!powerloss_last_valid) {
+      return 0;
+   }
+   return simple_read_from_buffer(buf, count, ppos, &powerloss_last,
+                                  sizeof(powerloss_last));
+}
+
+static const struct file_operations scd_powerloss_file_ops = {
+   .owner = THIS_MODULE,
+   .read = scd_powerloss_read,
+   .llseek = default_llseek,
+};
+
+#define SCD_POWERLOSS_PROC_NAME "scd_powerloss"
+
 static void scd_procfs_create( void ) {
    struct proc_dir_entry *entry;
    entry = proc_create( SCD_MODULE_NAME, 0, NULL, &scd_dump_file_ops );
+   if (powerloss_record) {
+      entry = proc_create( SCD_POWERLOSS_PROC_NAME, S_IRUSR, NULL,
+                           &scd_powerloss_file_ops );
+   }
 }
 
 static void scd_procfs_remove( void ) {
    (void) remove_proc_entry( SCD_MODULE_NAME, NULL );
+   if (powerloss_record) {
+      (void) remove_proc_entry( SCD_POWERLOSS_PROC_NAME, NULL );
+   }
+}
+
+// map the power loss record area and pick up what the previous boot left there
+static void scd_powerloss_init(void)
+{
+   if (!powerloss_record_addr) {
+      return;
+   }
+
+   powerloss_record = ioremap_nocache(powerloss_record_addr,
+                                      sizeof(struct scd_powerloss_record));
+   if (!powerloss_record) {
+      printk(KERN_ERR "%s: cannot map power loss record at 0x%lx\n",
+             SCD_MODULE_NAME, powerloss_record_addr);
+      return;
+   }
+
+   memcpy_fromio(&powerloss_last, powerloss_record, sizeof(powerloss_last));
+   if (powerloss_last.magic == SCD_POWERLOSS_MAGIC &&
+       powerloss_last.version == SCD_POWERLOSS_VERSION &&
+       powerloss_last.size == sizeof(powerloss_last)) {
+      printk(KERN_INFO "%s: power loss record found from previous boot\n",
+             SCD_MODULE_NAME);
+      powerloss_last_valid = true;
+   }
+
+   // only report a record once
+   iowrite32(0, powerloss_record);
+}
+
+static void scd_powerloss_exit(void)
+{
+   if (powerloss_record) {
+      iounmap(powerloss_record);
+      powerloss_record = NULL;
+   }
 }
 
 MODULE_DEVICE_TABLE(pci, scd_pci_table);
@@ -1667,12 +2628,17 @@ static int __init scd_init(void)
    int err;
    mutex_init(&scd_mutex);
    spin_lock_init(&scd_ptp_lock);
+   spin_lock_init(&scd_powerloss_lock);
    INIT_LIST_HEAD(&scd_list);
 
+   scd_powerloss_init();
+
    printk(KERN_INFO "scd module installed\n");
    err = pci_register_driver(&scd_driver);
    if(!err)
       scd_procfs_create();
+   else
+      scd_powerloss_exit();
 
    return err;
 }
@@ -1681,6 +2647,7 @@ static void __exit scd_exit(void)
 {
    pci_unregister_driver(&scd_driver);
    scd_procfs_remove();
+   scd_powerloss_exit();
    printk(KERN_INFO "scd module removed\n");
 }
 
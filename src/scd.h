@@ -57,5 +57,47 @@ void scd_write_register(struct pci_dev *pdev, u32 offset, u32 val);
 size_t scd_resource_len(struct pci_dev *pdev);
 u64 scd_ptp_timestamp(void);
 
+// flags of the register ranges given to scd_regmap_add_range
+#define SCD_REGMAP_PRECIOUS (1 << 0)
+
+struct regmap;
+struct regmap *scd_get_regmap(struct pci_dev *pdev);
+int scd_regmap_add_range(struct pci_dev *pdev, u32 start, u32 end, unsigned int flags);
+void scd_regmap_remove_range(struct pci_dev *pdev, u32 start, u32 end);
+
+// Page published read only through the ptp_time attribute, see lib/scd-ptp.h.
+// The ptp counter is sampled with CLOCK_MONOTONIC every interval_ns, seq is odd
+// while an update is in progress.
+#define SCD_PTP_PAGE_VERSION 1
+
+struct scd_ptp_page {
+   u32 seq;
+   u32 version;
+   u64 ptp_ns;        // ptp counter at the sample
+   u64 monotonic_ns;  // CLOCK_MONOTONIC at the sample
+   u64 interval_ns;   // period of the samples
+} __attribute__((packed));
+
+// Record written to reserved memory by the power loss interrupt and reported
+// through /proc/scd_powerloss after the next boot, see arista/core/powerloss.py
+#define SCD_POWERLOSS_MAGIC 0x50444353 // "SCDP"
+#define SCD_POWERLOSS_VERSION 1
+
+struct scd_powerloss_record {
+   u32 magic;
+   u16 version;
+   u16 size;
+   u32 count;          // power loss interrupts seen during this boot
+   u32 irq_reg;        // interrupt register that reported the power loss
+   u64 ptp_timestamp;  // scd ptp counter, 0 if not available
+   u64 realtime_ns;    // system wall clock
+   u32 status;         // interrupt status register
+   u32 mask;           // interrupt mask register
+   u32 revision;       // scd revision
+   u32 pci_id;         // pci bus << 8 | devfn of the scd
+   u64 interrupts;
+   u64 reserved;
+} __attribute__((packed));
+
 // Copyright (c) 2010-2016 Arista Networks, Inc.  All rights reserved.
 // Arista Networks, Inc. Confidential and Proprietary.